@@ -3,14 +3,14 @@
 
 #include "GoKart.h"
 
-#include "DrawDebugHelpers.h"
-#include "GameFramework/GameStateBase.h"
+#include "KartRollbackManager.h"
+#include "KrazyKartsGameState.h"
 
 // Sets default values
 AGoKart::AGoKart()
 {
- 	// Set this pawn to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+ 	// Movement and replication run in their components, the pawn itself doesn't need to tick
+	PrimaryActorTick.bCanEverTick = false;
 	bReplicates = true;
 
 	MovementComponent = CreateDefaultSubobject<UGoKartMovementComponent>(TEXT("MovementComponent"));
@@ -33,29 +33,68 @@ void AGoKart::BeginPlay()
 	}
 }
 
-FString AGoKart::GetEnumText(ENetRole NetRole)
+bool AGoKart::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
 {
-	switch (NetRole)
+	const AKrazyKartsGameState* RaceState = GetWorld()->GetGameState<AKrazyKartsGameState>();
+	if (RaceState && !RaceState->IsRelevantToViewer(this, RealViewer))
 	{
-	case ROLE_None:
-		return "None";
-	case ROLE_SimulatedProxy:
-		return "SimulatedProxy";
-	case ROLE_AutonomousProxy:
-		return "AutonomousProxy";
-	case ROLE_Authority:
-		return "Authority";
-	default:
-		return "ERROR";
+		return false;
 	}
+
+	return Super::IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation);
 }
 
-// Called every frame
-void AGoKart::Tick(float DeltaTime)
+void AGoKart::PostInitializeComponents()
 {
-	Super::Tick(DeltaTime);
-	
-	DrawDebugString(GetWorld(), FVector(0,0,100), GetEnumText(GetLocalRole()), this, FColor::White, 0);
+	Super::PostInitializeComponents();
+
+	if (MovementReplicator)
+	{
+		MovementReplicator->SetMovementComponent(MovementComponent);
+	}
+}
+
+void AGoKart::ReturnToPool()
+{
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+
+	if (MovementComponent)
+	{
+		MovementComponent->SetComponentTickEnabled(false);
+		MovementComponent->ResetState();
+	}
+	if (MovementReplicator)
+	{
+		MovementReplicator->SetComponentTickEnabled(false);
+		MovementReplicator->ResetState();
+	}
+
+	// Let clients see it hidden once, then stop considering it for replication
+	ForceNetUpdate();
+	SetNetDormancy(DORM_DormantAll);
+}
+
+void AGoKart::ActivateFromPool(const FTransform& Transform)
+{
+	SetActorTransform(Transform, false, nullptr, ETeleportType::TeleportPhysics);
+
+	if (MovementComponent)
+	{
+		MovementComponent->ResetState();
+		MovementComponent->SetComponentTickEnabled(true);
+	}
+	if (MovementReplicator)
+	{
+		MovementReplicator->ResetState();
+		MovementReplicator->SetComponentTickEnabled(true);
+	}
+
+	SetActorEnableCollision(true);
+	SetActorHiddenInGame(false);
+
+	SetNetDormancy(DORM_Awake);
+	ForceNetUpdate();
 }
 
 // Called to bind functionality to input
@@ -84,4 +123,31 @@ void AGoKart::MoveRight(float Value)
 	}
 	
 	MovementComponent->SetSteeringThrow(Value);
-}
\ No newline at end of file
+}
+
+void AGoKart::Server_SendRollbackInputs_Implementation(int32 LastFrame, const TArray<uint8>& PackedInputs)
+{
+	if (AKartRollbackManager* Manager = AKartRollbackManager::Find(GetWorld()))
+	{
+		Manager->RelayInputs(this, LastFrame, PackedInputs);
+	}
+}
+
+bool AGoKart::Server_SendRollbackInputs_Validate(int32 LastFrame, const TArray<uint8>& PackedInputs)
+{
+	// Pairs of throttle and steering, never more than a handful of frames
+	return LastFrame >= 0 && PackedInputs.Num() % 2 == 0 && PackedInputs.Num() <= 64;
+}
+
+void AGoKart::Server_RequestRollbackRestart_Implementation(float SessionStartTime)
+{
+	if (AKartRollbackManager* Manager = AKartRollbackManager::Find(GetWorld()))
+	{
+		Manager->RestartSession(this, SessionStartTime);
+	}
+}
+
+bool AGoKart::Server_RequestRollbackRestart_Validate(float SessionStartTime)
+{
+	return true;
+}
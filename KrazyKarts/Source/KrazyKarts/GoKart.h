@@ -21,20 +21,36 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
-public:	
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
+	virtual void PostInitializeComponents() override;
 
+public:	
 	// Called to bind functionality to input
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 
+	// Karts only replicate to players in the same race
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
+
+	UGoKartMovementComponent* GetKartMovement() const { return MovementComponent; }
+
+	// Hides the kart and stops it simulating and replicating until it is taken from the pool again
+	void ReturnToPool();
+
+	// Places a pooled kart at Transform, at rest, and brings it back into play
+	void ActivateFromPool(const FTransform& Transform);
+
+	// Sends the owning client's rollback inputs up to LastFrame, for the server to relay to every machine
+	UFUNCTION(Server, Unreliable, WithValidation)
+	void Server_SendRollbackInputs(int32 LastFrame, const TArray<uint8>& PackedInputs);
+
+	// Asks the server to start the rollback session again, when it began before it reached the owning client
+	UFUNCTION(Server, Reliable, WithValidation)
+	void Server_RequestRollbackRestart(float SessionStartTime);
+
 private:
 	
 	void MoveForward(float Value);
 	void MoveRight(float Value);
 
-	FString GetEnumText(ENetRole Role);
-
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
 	UGoKartMovementComponent* MovementComponent;
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GoKartBotController.h"
+
+#include "Components/SplineComponent.h"
+#include "GoKart.h"
+#include "KartTrack.h"
+#include "KrazyKartsGameState.h"
+
+AGoKartBotController::AGoKartBotController()
+{
+	// Inputs are held by the movement component between updates, so bots don't need to steer every frame
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickInterval = 0.1f;
+	bReplicates = false;
+}
+
+void AGoKartBotController::OnPossess(APawn* InPawn)
+{
+	Super::OnPossess(InPawn);
+
+	AGoKart* Kart = Cast<AGoKart>(InPawn);
+	MovementComponent = Kart ? Kart->GetKartMovement() : nullptr;
+	if (InPawn && !MovementComponent)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Bots can only drive an AGoKart, %s will sit still."), *InPawn->GetName());
+	}
+	// Each race drives its own instance of the track
+	AKrazyKartsGameState* RaceState = GetWorld()->GetGameState<AKrazyKartsGameState>();
+	Track = RaceState ? RaceState->GetTrack(InPawn) : AKartTrack::FindTrack(GetWorld());
+	TrackSegment = INDEX_NONE;
+	LateralOffset = FMath::FRandRange(-MaxLateralOffset, MaxLateralOffset);
+}
+
+void AGoKartBotController::OnUnPossess()
+{
+	Super::OnUnPossess();
+
+	MovementComponent = nullptr;
+}
+
+void AGoKartBotController::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	UpdateInput();
+}
+
+void AGoKartBotController::UpdateInput()
+{
+	APawn* Kart = GetPawn();
+	if (!Kart || !MovementComponent || !Track)
+	{
+		return;
+	}
+
+	FKartTrackProjection Projection = Track->ProjectPoint(Kart->GetActorLocation(), TrackSegment);
+	if (Projection.Segment == INDEX_NONE)
+	{
+		return;
+	}
+	TrackSegment = Projection.Segment;
+
+	USplineComponent* Spline = Track->GetSpline();
+	float Distance = Projection.Distance + LookAheadDistance;
+	float Length = Track->GetLength();
+	Distance = Spline->IsClosedLoop() ? FMath::Fmod(Distance, Length) : FMath::Min(Distance, Length);
+
+	FVector Target = Spline->GetLocationAtDistanceAlongSpline(Distance, ESplineCoordinateSpace::World);
+	Target += Spline->GetRightVectorAtDistanceAlongSpline(Distance, ESplineCoordinateSpace::World) * LateralOffset;
+
+	FVector LocalTarget = Kart->GetActorTransform().InverseTransformPosition(Target);
+	float Angle = FMath::RadiansToDegrees(FMath::Atan2(LocalTarget.Y, LocalTarget.X));
+	float SteeringThrow = FMath::Clamp(Angle / FullLockAngle, -1.0f, 1.0f);
+
+	MovementComponent->SetSteeringThrow(SteeringThrow);
+	MovementComponent->SetThrottle(FMath::Lerp(1.0f, CorneringThrottle, FMath::Abs(SteeringThrow)));
+}
@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Controller.h"
+#include "GoKartBotController.generated.h"
+
+class AKartTrack;
+class UGoKartMovementComponent;
+
+// Drives a possessed AGoKart around the track spline, cheap enough to run hundreds per server
+UCLASS()
+class KRAZYKARTS_API AGoKartBotController : public AController
+{
+	GENERATED_BODY()
+
+public:
+	AGoKartBotController();
+
+	virtual void Tick(float DeltaTime) override;
+
+protected:
+	virtual void OnPossess(APawn* InPawn) override;
+	virtual void OnUnPossess() override;
+
+private:
+	void UpdateInput();
+
+	// How far ahead along the track the bot aims (cm)
+	UPROPERTY(EditAnywhere)
+	float LookAheadDistance = 1500;
+
+	// Steering angle to the aim point that results in full lock (degrees)
+	UPROPERTY(EditAnywhere)
+	float FullLockAngle = 30;
+
+	// Throttle used at full lock, blended up to 1 when driving straight
+	UPROPERTY(EditAnywhere)
+	float CorneringThrottle = 0.4;
+
+	// Each bot follows a line offset from the centerline by up to this much (cm)
+	UPROPERTY(EditAnywhere)
+	float MaxLateralOffset = 300;
+
+	float LateralOffset;
+
+	// Last track segment the kart was on, narrows the next closest point search
+	int32 TrackSegment;
+
+	UPROPERTY()
+	AKartTrack* Track;
+
+	UPROPERTY()
+	UGoKartMovementComponent* MovementComponent;
+};
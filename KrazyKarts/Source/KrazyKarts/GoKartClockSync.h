@@ -0,0 +1,106 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Estimates server time on a client from round trips of timestamped requests, NTP style
+struct FGoKartClockSync
+{
+	static const int32 WindowSize = 8;
+
+	// Round trip of the last sample, the fastest in the window and a running average (s)
+	float LastRoundTripTime = 0;
+	float MinRoundTripTime = 0;
+	float SmoothedRoundTripTime = 0;
+
+	// Average change in round trip time between samples (s)
+	float Jitter = 0;
+
+	uint32 NumSamples = 0;
+
+	bool IsSynchronized() const { return NumSamples > 0; }
+
+	// True once Seed or a sample has given the estimate an offset to run from
+	bool HasEstimate() const { return bSeeded || NumSamples > 0; }
+
+	// Starts the estimate from a rough server time, such as the game state's, so the first sample slews away from it
+	// instead of stepping the time
+	void Seed(float ClientTime, float RoughServerTime)
+	{
+		ClockOffset = RoughServerTime - ClientTime;
+		TargetOffset = ClockOffset;
+		ServerTime = FMath::Max(ServerTime, RoughServerTime);
+		bSeeded = true;
+	}
+
+	// Monotonic estimate of the server time, as of the last Tick (s)
+	float GetServerTime() const { return ServerTime; }
+
+	void AddSample(float ClientSendTime, float ServerReceiveTime, float ClientReceiveTime)
+	{
+		float RoundTripTime = ClientReceiveTime - ClientSendTime;
+		if (RoundTripTime < 0)
+		{
+			return;
+		}
+
+		// Assumes the request and the reply took equally long
+		float Offset = ServerReceiveTime + RoundTripTime / 2 - ClientReceiveTime;
+
+		if (NumSamples == 0)
+		{
+			SmoothedRoundTripTime = RoundTripTime;
+		}
+		else
+		{
+			Jitter += (FMath::Abs(RoundTripTime - LastRoundTripTime) - Jitter) / 16;
+			SmoothedRoundTripTime = FMath::Lerp(SmoothedRoundTripTime, RoundTripTime, 0.125f);
+		}
+		LastRoundTripTime = RoundTripTime;
+
+		Samples[NumSamples % WindowSize] = { RoundTripTime, Offset };
+		++NumSamples;
+
+		// Queuing and resends only ever add delay, so the fastest recent round trip gives the most trustworthy offset
+		const FSample* Best = &Samples[0];
+		for (int32 i = 1; i < FMath::Min<int32>(NumSamples, WindowSize); ++i)
+		{
+			if (Samples[i].RoundTripTime < Best->RoundTripTime)
+			{
+				Best = &Samples[i];
+			}
+		}
+		MinRoundTripTime = Best->RoundTripTime;
+		TargetOffset = Best->Offset;
+
+		// Without a seed there is no estimate to slew from yet
+		if (NumSamples == 1 && !bSeeded)
+		{
+			ClockOffset = TargetOffset;
+			ServerTime = ClientReceiveTime + ClockOffset;
+		}
+	}
+
+	void Tick(float ClientTime, float DeltaTime, float MaxSlewRate)
+	{
+		// Slew towards the new offset instead of stepping, so the estimate never jumps or runs backwards
+		float MaxSlew = MaxSlewRate * DeltaTime;
+		ClockOffset += FMath::Clamp(TargetOffset - ClockOffset, -MaxSlew, MaxSlew);
+		ServerTime = FMath::Max(ServerTime, ClientTime + ClockOffset);
+	}
+
+private:
+	struct FSample
+	{
+		float RoundTripTime;
+		float Offset;
+	};
+
+	FSample Samples[WindowSize];
+
+	float TargetOffset = 0;
+	float ClockOffset = 0;
+	float ServerTime = 0;
+	bool bSeeded = false;
+};
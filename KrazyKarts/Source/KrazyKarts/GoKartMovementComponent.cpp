@@ -3,7 +3,10 @@
 
 #include "GoKartMovementComponent.h"
 
-#include "GameFramework/GameStateBase.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+
+#include "GoKartMovementReplicator.h"
+#include "KartBroadphase.h"
 
 // Sets default values for this component's properties
 UGoKartMovementComponent::UGoKartMovementComponent()
@@ -21,8 +24,22 @@ void UGoKartMovementComponent::BeginPlay()
 {
 	Super::BeginPlay();
 
-	// ...
-	
+	UKartBroadphase* Broadphase = GetWorld()->GetSubsystem<UKartBroadphase>();
+	if (Broadphase && bKartContacts)
+	{
+		BroadphaseId = Broadphase->Register(this, CollisionRadius > 0 ? CollisionRadius : GetOwner()->GetSimpleCollisionRadius());
+	}
+}
+
+void UGoKartMovementComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UKartBroadphase* Broadphase = GetWorld()->GetSubsystem<UKartBroadphase>())
+	{
+		Broadphase->Unregister(BroadphaseId);
+	}
+	BroadphaseId = INDEX_NONE;
+
+	Super::EndPlay(EndPlayReason);
 }
 
 
@@ -40,6 +57,35 @@ void UGoKartMovementComponent::TickComponent(float DeltaTime, ELevelTick TickTyp
 }
 
 void UGoKartMovementComponent::SimulateMove(const FGoKartMove& Move)
+{
+#if KART_FIXED_POINT_SIMULATION
+	SimulateFixedMove(Move);
+#else
+	if (Move.DeltaTime > MaxEulerStepTime)
+	{
+		SimulateIntegratedMove(Move);
+	}
+	else
+	{
+		SimulateEulerMove(Move);
+	}
+#endif
+
+	ResolveKartCollisions();
+}
+
+void UGoKartMovementComponent::ReplayMoves(const TArray<FGoKartMove>& Moves)
+{
+	// Replayed from the server state, bumps are resolved again along the way
+	if (UKartBroadphase* Broadphase = GetWorld()->GetSubsystem<UKartBroadphase>())
+	{
+		Broadphase->ForgetContacts(BroadphaseId);
+	}
+
+	IReplicatedVehicleMovement::ReplayMoves(Moves);
+}
+
+void UGoKartMovementComponent::SimulateEulerMove(const FGoKartMove& Move)
 {
 	FVector Force = MaxDrivingForce * Move.Throttle * GetOwner()->GetActorForwardVector();
 	Force += GetAirResistance();
@@ -51,13 +97,173 @@ void UGoKartMovementComponent::SimulateMove(const FGoKartMove& Move)
 	UpdateLocationFromVelocity(Move.DeltaTime);
 }
 
+void UGoKartMovementComponent::SimulateIntegratedMove(const FGoKartMove& Move)
+{
+	const FVector Up = GetOwner()->GetActorUpVector();
+	const FVector Forward = GetOwner()->GetActorForwardVector();
+	const FVector Right = FVector::CrossProduct(Up, Forward);
+
+	// State is (KartVelocity, Heading, X, Y) in the frame of the kart at the start of the move. Velocity is kept along
+	// and across the heading and turns with it, as the Euler step rotates the whole velocity, so sideways speed
+	// left by a bump decays under resistance the same way.
+	FVector2D KartVelocity(FVector::DotProduct(Velocity, Forward), FVector::DotProduct(Velocity, Right));
+	float Heading = 0;
+	FVector2D Translation = FVector2D::ZeroVector;
+
+	const float TurnRate = Move.SteeringThrow / MinTurningRadius; // rad/m
+	const float RollingResistanceForce = GetRollingResistanceCoefficient() * GetNormalForce();
+	const bool bResistanceHoldsKart = FMath::Abs(MaxDrivingForce * Move.Throttle) <= RollingResistanceForce;
+	const int32 NumSteps = FMath::Max(1, FMath::CeilToInt(Move.DeltaTime / MaxIntegratorStepTime));
+	const float Step = Move.DeltaTime / NumSteps;
+
+	for (int32 i = 0; i < NumSteps; ++i)
+	{
+		const FVector2D V1 = KartVelocity;
+		const float H1 = Heading;
+		const FVector2D A1 = GetVelocityDerivative(V1, Move.Throttle, RollingResistanceForce);
+
+		const FVector2D V2 = KartVelocity + A1 * Step / 2;
+		const float H2 = Heading + V1.X * TurnRate * Step / 2;
+		const FVector2D A2 = GetVelocityDerivative(V2, Move.Throttle, RollingResistanceForce);
+
+		const FVector2D V3 = KartVelocity + A2 * Step / 2;
+		const float H3 = Heading + V2.X * TurnRate * Step / 2;
+		const FVector2D A3 = GetVelocityDerivative(V3, Move.Throttle, RollingResistanceForce);
+
+		const FVector2D V4 = KartVelocity + A3 * Step;
+		const float H4 = Heading + V3.X * TurnRate * Step;
+		const FVector2D A4 = GetVelocityDerivative(V4, Move.Throttle, RollingResistanceForce);
+
+		Translation += Step / 6 * (V1.GetRotated(FMath::RadiansToDegrees(H1)) + 2 * V2.GetRotated(FMath::RadiansToDegrees(H2))
+			+ 2 * V3.GetRotated(FMath::RadiansToDegrees(H3)) + V4.GetRotated(FMath::RadiansToDegrees(H4)));
+		Heading += Step / 6 * (V1.X + 2 * V2.X + 2 * V3.X + V4.X) * TurnRate;
+
+		const FVector2D NewVelocity = KartVelocity + Step / 6 * (A1 + 2 * A2 + 2 * A3 + A4);
+
+		// Resistance can only bring the kart to rest, never push it backwards. Nothing drives it sideways
+		KartVelocity.X = bResistanceHoldsKart && NewVelocity.X * KartVelocity.X < 0 ? 0 : NewVelocity.X;
+		KartVelocity.Y = NewVelocity.Y * KartVelocity.Y < 0 ? 0 : NewVelocity.Y;
+	}
+
+	const FQuat RotationDelta(Up, Heading);
+	Velocity = RotationDelta.RotateVector(Forward * KartVelocity.X + Right * KartVelocity.Y);
+	GetOwner()->AddActorWorldRotation(RotationDelta);
+	ApplyTranslation((Forward * Translation.X + Right * Translation.Y) * 100.0f);
+}
+
+void UGoKartMovementComponent::SimulateFixedMove(const FGoKartMove& Move)
+{
+	// Teleports, pooling and rollback move the actor directly, the fixed state has to follow
+	if (!GetOwner()->GetActorLocation().Equals(FixedStateLocation, 0))
+	{
+		FVector Forward = GetOwner()->GetActorForwardVector();
+		FixedState.X = KartFixed::FromFloat(GetOwner()->GetActorLocation().X);
+		FixedState.Y = KartFixed::FromFloat(GetOwner()->GetActorLocation().Y);
+		FixedState.Speed = KartFixed::FromFloat(FVector::DotProduct(Velocity, Forward));
+		FixedState.Heading = KartFixed::FromFloat(FMath::Atan2(Forward.Y, Forward.X));
+	}
+
+	FKartFixedStep::Simulate(FixedState, GetFixedParams(),
+		KartFixed::FromFloat(Move.Throttle), KartFixed::FromFloat(Move.SteeringThrow), KartFixed::FromFloat(Move.DeltaTime));
+
+	ApplyFixedState();
+}
+
+FKartFixedParams UGoKartMovementComponent::GetFixedParams()
+{
+	FKartFixedParams Params;
+	Params.Mass = KartFixed::FromFloat(Mass);
+	Params.MaxDrivingForce = KartFixed::FromFloat(MaxDrivingForce);
+	Params.MinTurningRadius = KartFixed::FromFloat(MinTurningRadius);
+	Params.DragCoefficient = KartFixed::FromFloat(DragCoefficient);
+	Params.RollingResistanceForce = KartFixed::FromFloat(GetRollingResistanceCoefficient() * GetNormalForce());
+	Params.MaxStepTime = FMath::Max<int64>(KartFixed::FromFloat(MaxEulerStepTime), 1);
+	return Params;
+}
+
+void UGoKartMovementComponent::SetFixedState(const FGoKartFixedState& State)
+{
+	FixedState = State;
+	GetOwner()->SetActorLocation(FVector(KartFixed::ToFloat(State.X), KartFixed::ToFloat(State.Y), GetOwner()->GetActorLocation().Z),
+		false, nullptr, ETeleportType::TeleportPhysics);
+	ApplyFixedState();
+}
+
+void UGoKartMovementComponent::ApplyFixedState()
+{
+	// The actor only shows the fixed state, float rounding here never feeds back into the simulation
+	float Heading = KartFixed::ToFloat(FixedState.Heading);
+	FVector Forward(FMath::Cos(Heading), FMath::Sin(Heading), 0);
+	Velocity = Forward * KartFixed::ToFloat(FixedState.Speed);
+	GetOwner()->SetActorRotation(Forward.ToOrientationQuat(), ETeleportType::TeleportPhysics);
+
+	FVector Target(KartFixed::ToFloat(FixedState.X), KartFixed::ToFloat(FixedState.Y), GetOwner()->GetActorLocation().Z);
+	ApplyTranslation(Target - GetOwner()->GetActorLocation());
+	if (FixedState.Speed != 0 && Velocity.IsZero())
+	{
+		// Blocked, continue from where the sweep stopped
+		FixedState.Speed = 0;
+		FixedState.X = KartFixed::FromFloat(GetOwner()->GetActorLocation().X);
+		FixedState.Y = KartFixed::FromFloat(GetOwner()->GetActorLocation().Y);
+	}
+	FixedStateLocation = GetOwner()->GetActorLocation();
+}
+
+FVector2D UGoKartMovementComponent::GetVelocityDerivative(const FVector2D& KartVelocity, float MoveThrottle, float RollingResistanceForce)
+{
+	// Resistance opposes the whole velocity, as GetAirResistance and GetRollingResistance do
+	FVector2D Force(MaxDrivingForce * MoveThrottle, 0);
+	const float Speed = KartVelocity.Size();
+	if (Speed > 0)
+	{
+		Force -= KartVelocity / Speed * (Speed * Speed * DragCoefficient + RollingResistanceForce);
+	}
+	return Force / Mass;
+}
+
+void UGoKartMovementComponent::ResetState()
+{
+	Velocity = FVector::ZeroVector;
+	Throttle = 0;
+	SteeringThrow = 0;
+	LastMove = FGoKartMove();
+}
+
+FGoKartSimState UGoKartMovementComponent::SaveSimState() const
+{
+	FGoKartSimState State;
+	State.Location = GetOwner()->GetActorLocation();
+	State.Rotation = GetOwner()->GetActorQuat();
+	State.Velocity = Velocity;
+	State.FixedState = FixedState;
+	State.FixedStateLocation = FixedStateLocation;
+	return State;
+}
+
+void UGoKartMovementComponent::RestoreSimState(const FGoKartSimState& State)
+{
+	GetOwner()->SetActorLocationAndRotation(State.Location, State.Rotation, false, nullptr, ETeleportType::TeleportPhysics);
+	Velocity = State.Velocity;
+
+	// Still out of step with the actor if it was when saved, so resimulation rebuilds it exactly where the original did
+	FixedState = State.FixedState;
+	FixedStateLocation = State.FixedStateLocation;
+
+	// Karts resimulated after this one collide with where it was restored to, and resolve their contacts again
+	if (UKartBroadphase* Broadphase = GetWorld()->GetSubsystem<UKartBroadphase>())
+	{
+		Broadphase->Update(BroadphaseId);
+		Broadphase->ForgetContacts(BroadphaseId);
+	}
+}
+
 FGoKartMove UGoKartMovementComponent::CreateMove(float DeltaTime)
 {
 	FGoKartMove Move;
 	Move.DeltaTime = DeltaTime;
 	Move.Throttle = Throttle;
 	Move.SteeringThrow = SteeringThrow;
-	Move.StartTime = GetWorld()->GetGameState()->GetServerWorldTimeSeconds();
+	Move.StartTime = UGoKartMovementReplicator::GetMoveTime(GetOwner());
 
 	return Move;
 }
@@ -68,10 +274,46 @@ FVector UGoKartMovementComponent::GetAirResistance()
 }
 
 FVector UGoKartMovementComponent::GetRollingResistance()
+{
+	return - Velocity.GetSafeNormal() * GetRollingResistanceCoefficient() * GetNormalForce();
+}
+
+float UGoKartMovementComponent::GetRollingResistanceCoefficient()
+{
+	if (SurfaceRollingResistance.Num() == 0)
+	{
+		return RollingResistanceCoefficient;
+	}
+
+	// Moves and replays inside the same cell reuse the last trace
+	FVector Location = GetOwner()->GetActorLocation();
+	FIntPoint Cell(FMath::FloorToInt(Location.X / SurfaceCellSize), FMath::FloorToInt(Location.Y / SurfaceCellSize));
+	if (Cell == SurfaceCell)
+	{
+		return SurfaceRollingResistanceCoefficient;
+	}
+	SurfaceCell = Cell;
+	SurfaceRollingResistanceCoefficient = RollingResistanceCoefficient;
+
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(KartSurfaceTrace), false, GetOwner());
+	Params.bReturnPhysicalMaterial = true;
+
+	FHitResult Hit;
+	FVector End = Location - GetOwner()->GetActorUpVector() * SurfaceTraceDistance;
+	if (GetWorld()->LineTraceSingleByChannel(Hit, Location, End, ECC_Visibility, Params))
+	{
+		if (const float* Coefficient = SurfaceRollingResistance.Find(Hit.PhysMaterial.Get()))
+		{
+			SurfaceRollingResistanceCoefficient = *Coefficient;
+		}
+	}
+	return SurfaceRollingResistanceCoefficient;
+}
+
+float UGoKartMovementComponent::GetNormalForce()
 {
 	float AccelerationDueToGravity = - GetWorld()->GetGravityZ() / 100;
-	float NormalForce = Mass * AccelerationDueToGravity;
-	return - Velocity.GetSafeNormal() * RollingResistanceCoefficient * NormalForce;
+	return Mass * AccelerationDueToGravity;
 }
 
 void UGoKartMovementComponent::ApplyRotation(float DeltaTime, float MoveSteeringThrow)
@@ -85,7 +327,76 @@ void UGoKartMovementComponent::ApplyRotation(float DeltaTime, float MoveSteering
 
 void UGoKartMovementComponent::UpdateLocationFromVelocity(float DeltaTime)
 {
-	FVector Translation = Velocity * 100.0f * DeltaTime;
+	ApplyTranslation(Velocity * 100.0f * DeltaTime);
+}
+
+void UGoKartMovementComponent::ResolveKartCollisions()
+{
+	UKartBroadphase* Broadphase = GetWorld()->GetSubsystem<UKartBroadphase>();
+	if (!Broadphase || BroadphaseId == INDEX_NONE || !GetOwner()->GetActorEnableCollision())
+	{
+		return;
+	}
+
+	Broadphase->MarkSimulated(BroadphaseId);
+	Broadphase->Update(BroadphaseId);
+
+	TArray<FKartOverlap, TInlineAllocator<8>> Overlaps;
+	Broadphase->QueryOverlaps(BroadphaseId, Overlaps);
+
+	for (const FKartOverlap& Overlap : Overlaps)
+	{
+		const float OtherMass = Overlap.Kart->Mass;
+		const FVector Normal(Overlap.Normal, 0);
+
+		// The other kart moves itself out by the rest of the penetration in its own move, heavier karts give way less.
+		// Swept, so a kart pushed towards a wall stops at it, without losing its velocity the way ApplyTranslation would
+		FHitResult OutSweepHitResult;
+		GetOwner()->AddActorWorldOffset(Normal * Overlap.Penetration * OtherMass / (Mass + OtherMass), true, &OutSweepHitResult);
+
+		// The first of the two karts to find the contact works out the impulse for both from their velocities (m/s)
+		// before either has taken it
+		if (!Broadphase->IsContactPending(BroadphaseId, Overlap.Id))
+		{
+			const float ClosingSpeed = FVector::DotProduct(Velocity - Overlap.Kart->GetVelocity(), Normal);
+			if (ClosingSpeed < 0)
+			{
+				const float ContactRestitution = (Restitution + Overlap.Kart->Restitution) / 2;
+				const float Impulse = -(1 + ContactRestitution) * ClosingSpeed / (1 / Mass + 1 / OtherMass);
+				if (Broadphase->IsSimulating(Overlap.Id))
+				{
+					Broadphase->AddContact(BroadphaseId, Overlap.Id, Normal * Impulse);
+				}
+				else
+				{
+					// The other kart runs no moves here to take its share in, so both take it now
+					ApplyImpulse(Normal * Impulse);
+					Overlap.Kart->ApplyImpulse(-Normal * Impulse);
+				}
+			}
+		}
+	}
+
+	// Includes contacts the other kart found first, even if this one has since moved clear
+	ApplyImpulse(Broadphase->TakeContactImpulse(BroadphaseId));
+
+	Broadphase->Update(BroadphaseId);
+}
+
+void UGoKartMovementComponent::ApplyImpulse(const FVector& Impulse)
+{
+	Velocity += Impulse / Mass;
+
+#if KART_FIXED_POINT_SIMULATION
+	// The next move starts from the fixed state, which only holds speed along the heading
+	float Heading = KartFixed::ToFloat(FixedState.Heading);
+	FVector Forward(FMath::Cos(Heading), FMath::Sin(Heading), 0);
+	FixedState.Speed += KartFixed::FromFloat(FVector::DotProduct(Impulse / Mass, Forward));
+#endif
+}
+
+void UGoKartMovementComponent::ApplyTranslation(const FVector& Translation)
+{
 	FHitResult OutSweepHitResult;
 	GetOwner()->AddActorWorldOffset(Translation, true, &OutSweepHitResult);
 	if (OutSweepHitResult.IsValidBlockingHit())
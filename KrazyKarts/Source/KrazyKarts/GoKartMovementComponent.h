@@ -4,33 +4,26 @@
 
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
+#include "ReplicatedVehicleMovement.h"
+#include "KartFixedPoint.h"
 #include "GoKartMovementComponent.generated.h"
 
-USTRUCT()
-struct FGoKartMove
-{
-	GENERATED_USTRUCT_BODY()
-
-	UPROPERTY()
-	float Throttle;
-	
-	UPROPERTY()
-	float SteeringThrow;
-	
-	UPROPERTY()
-	float DeltaTime;
+class UPhysicalMaterial;
 
-	UPROPERTY()
-	float StartTime;
+// Everything a move reads and writes, saved and restored when rolling the kart back
+struct FGoKartSimState
+{
+	FVector Location;
+	FQuat Rotation;
+	FVector Velocity;
 
-	bool IsValid() const
-	{
-		return FMath::Abs(Throttle) <= 1 && FMath::Abs(SteeringThrow) <= 1;
-	}
+	// Fixed point builds resume from these rather than rebuilding the state from the floats above
+	FGoKartFixedState FixedState;
+	FVector FixedStateLocation;
 };
 
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
-class KRAZYKARTS_API UGoKartMovementComponent : public UActorComponent
+class KRAZYKARTS_API UGoKartMovementComponent : public UActorComponent, public IReplicatedVehicleMovement
 {
 	GENERATED_BODY()
 
@@ -41,29 +34,69 @@ public:
 protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:	
 	// Called every frame
 	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 
-	void SimulateMove(const FGoKartMove& Move);
+	virtual void SimulateMove(const FGoKartMove& Move) override;
+	virtual void ReplayMoves(const TArray<FGoKartMove>& Moves) override;
 
-	FVector GetVelocity() { return Velocity; }
-	void SetVelocity(FVector NewVelocity) { Velocity = NewVelocity; }
+	virtual FVector GetVelocity() override { return Velocity; }
+	virtual void SetVelocity(FVector NewVelocity) override { Velocity = NewVelocity; }
 	
 	void SetThrottle(float NewThrottle) { Throttle = NewThrottle; }
 	void SetSteeringThrow(float NewSteeringThrow) { SteeringThrow = NewSteeringThrow; }
+	float GetThrottle() const { return Throttle; }
+	float GetSteeringThrow() const { return SteeringThrow; }
+
+	FGoKartSimState SaveSimState() const;
+	void RestoreSimState(const FGoKartSimState& State);
+
+	virtual FGoKartMove GetLastMove() override { return LastMove; }
 
-	FGoKartMove GetLastMove() { return LastMove; }
+	virtual FGoKartFixedState GetFixedState() override { return FixedState; }
+	virtual void SetFixedState(const FGoKartFixedState& State) override;
+
+	// Brings the kart to rest with no input, for karts recycled by the pool
+	void ResetState();
+
+	// Must be set before BeginPlay. Pooled karts stay registered and are skipped while their collision is off
+	void SetKartContactsEnabled(bool bEnabled) { bKartContacts = bEnabled; }
 
 private:
 	FGoKartMove CreateMove(float DeltaTime);
+
+	void SimulateEulerMove(const FGoKartMove& Move);
+
+	// Pushes the kart out of the karts it overlaps and takes its share of the contact impulse. Done at the end of every
+	// move from where the other karts are now, so clients predict and replay bumps the same way the server does them
+	void ResolveKartCollisions();
+
+	// Changes the velocity by a contact impulse (kg m/s), in fixed point builds the fixed state as well
+	void ApplyImpulse(const FVector& Impulse);
 	
+	// Advances the move in fixed point from FixedState, used instead of SimulateMove's float math when
+	// the module is built with KART_FIXED_POINT_SIMULATION
+	void SimulateFixedMove(const FGoKartMove& Move);
+	FKartFixedParams GetFixedParams();
+	void ApplyFixedState();
+
+	// Advances a long move in one evaluation, integrating velocity and heading with RK4
+	void SimulateIntegratedMove(const FGoKartMove& Move);
+
+	// Acceleration along (X) and across (Y) the heading at a velocity in the same frame (m/s^2)
+	FVector2D GetVelocityDerivative(const FVector2D& KartVelocity, float MoveThrottle, float RollingResistanceForce);
+
 	FVector GetAirResistance();
 	FVector GetRollingResistance();
+	float GetNormalForce();
+	float GetRollingResistanceCoefficient();
 	
 	void ApplyRotation(float DeltaTime, float MoveSteeringThrow);
 	void UpdateLocationFromVelocity(float DeltaTime);
+	void ApplyTranslation(const FVector& Translation);
 
 	// Mass of the car (kg)
 	UPROPERTY(EditAnywhere)
@@ -85,6 +118,38 @@ private:
 	UPROPERTY(EditAnywhere)
 	float RollingResistanceCoefficient = 0.015;
 
+	// Rolling resistance on surfaces with these physical materials, RollingResistanceCoefficient elsewhere
+	UPROPERTY(EditAnywhere)
+	TMap<UPhysicalMaterial*, float> SurfaceRollingResistance;
+
+	// The surface is traced again only when the kart enters a new cell of this size (cm)
+	UPROPERTY(EditAnywhere)
+	float SurfaceCellSize = 200;
+
+	// How far below the kart the surface is looked for (cm)
+	UPROPERTY(EditAnywhere)
+	float SurfaceTraceDistance = 200;
+
+	// Radius of the kart as seen from above for kart to kart contacts, 0 takes it from the actor's bounds (cm)
+	UPROPERTY(EditAnywhere)
+	float CollisionRadius = 0;
+
+	// Takes part in kart to kart contacts, off for stand ins that only show a kart, like ghosts
+	UPROPERTY(EditAnywhere)
+	bool bKartContacts = true;
+
+	// Share of the closing speed karts bounce apart with, 0 stops them dead along the contact and 1 bounces fully
+	UPROPERTY(EditAnywhere)
+	float Restitution = 0.3;
+
+	// Moves longer than this are advanced with the RK4 integrator instead of a single Euler step (s)
+	UPROPERTY(EditAnywhere)
+	float MaxEulerStepTime = 0.05;
+
+	// Longest substep taken by the RK4 integrator, bounds its error for coalesced moves (s)
+	UPROPERTY(EditAnywhere)
+	float MaxIntegratorStepTime = 0.1;
+
 	FVector Velocity;
 	
 	float Throttle;
@@ -92,4 +157,14 @@ private:
 	float SteeringThrow;
 
 	FGoKartMove LastMove;
+
+	FGoKartFixedState FixedState;
+
+	// Where the fixed point state last put the kart, it is taken from the actor again if the kart was moved since
+	FVector FixedStateLocation = FVector(MAX_flt);
+
+	int32 BroadphaseId = INDEX_NONE;
+
+	FIntPoint SurfaceCell = FIntPoint(MAX_int32, MAX_int32);
+	float SurfaceRollingResistanceCoefficient;
 };
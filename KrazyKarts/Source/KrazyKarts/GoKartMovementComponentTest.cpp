@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GoKartMovementComponent.h"
+
+#include "Components/SceneComponent.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS && !KART_FIXED_POINT_SIMULATION
+
+namespace
+{
+	UGoKartMovementComponent* SpawnTestKart(UWorld* World)
+	{
+		AActor* Kart = World->SpawnActor<AActor>();
+		USceneComponent* Root = NewObject<USceneComponent>(Kart);
+		Kart->SetRootComponent(Root);
+		Root->RegisterComponent();
+
+		UGoKartMovementComponent* Movement = NewObject<UGoKartMovementComponent>(Kart);
+		Movement->RegisterComponent();
+
+		// Sliding sideways, as after a bump
+		Movement->SetVelocity(FVector(0, 6, 0));
+		return Movement;
+	}
+
+	void DriveTestKart(UGoKartMovementComponent* Movement, float MoveTime)
+	{
+		// Accelerate, turn both ways, brake into reverse and coast, a second each
+		const float Inputs[][2] = { { 1, 0 }, { 1, 0.5f }, { 0.3f, -1 }, { -0.5f, 0.2f }, { 0, 0 } };
+		const int32 MovesPerPhase = FMath::RoundToInt(1 / MoveTime);
+		for (const float* Input : Inputs)
+		{
+			FGoKartMove Move;
+			Move.Throttle = Input[0];
+			Move.SteeringThrow = Input[1];
+			Move.DeltaTime = MoveTime;
+			Move.StartTime = 0;
+			for (int32 i = 0; i < MovesPerPhase; ++i)
+			{
+				Movement->SimulateMove(Move);
+			}
+		}
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FGoKartIntegratorTest, "KrazyKarts.Simulation.IntegratorsAgree",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FGoKartIntegratorTest::RunTest(const FString& Parameters)
+{
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+
+	// Short moves take the Euler step, long ones RK4. Euler moves are far shorter than a frame so its own error,
+	// which is first order, stays well inside the tolerances
+	UGoKartMovementComponent* Euler = SpawnTestKart(World);
+	UGoKartMovementComponent* Integrated = SpawnTestKart(World);
+	DriveTestKart(Euler, 1 / 600.0f);
+	DriveTestKart(Integrated, 0.25f);
+
+	const FVector EulerLocation = Euler->GetOwner()->GetActorLocation();
+	const FVector IntegratedLocation = Integrated->GetOwner()->GetActorLocation();
+	TestTrue(FString::Printf(TEXT("Locations agree, Euler %s and RK4 %s"), *EulerLocation.ToString(), *IntegratedLocation.ToString()),
+		EulerLocation.Equals(IntegratedLocation, 3));
+
+	const float EulerYaw = Euler->GetOwner()->GetActorRotation().Yaw;
+	const float IntegratedYaw = Integrated->GetOwner()->GetActorRotation().Yaw;
+	TestTrue(FString::Printf(TEXT("Headings agree, Euler %.3f and RK4 %.3f"), EulerYaw, IntegratedYaw),
+		FMath::Abs(FRotator::NormalizeAxis(EulerYaw - IntegratedYaw)) < 0.05f);
+
+	// Includes the sideways speed left from the start, which RK4 must carry and decay like Euler
+	const FVector EulerVelocity = Euler->GetVelocity();
+	const FVector IntegratedVelocity = Integrated->GetVelocity();
+	TestTrue(FString::Printf(TEXT("Velocities agree, Euler %s and RK4 %s"), *EulerVelocity.ToString(), *IntegratedVelocity.ToString()),
+		EulerVelocity.Equals(IntegratedVelocity, 0.02f));
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	return true;
+}
+
+#endif
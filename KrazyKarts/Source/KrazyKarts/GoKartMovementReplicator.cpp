@@ -3,9 +3,37 @@
 
 #include "GoKartMovementReplicator.h"
 
+#include "DrawDebugHelpers.h"
+#include "Engine/ActorChannel.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
 #include "GameFramework/GameStateBase.h"
+#include "GameFramework/PlayerController.h"
 #include "Net/UnrealNetwork.h"
 
+#include "KartFixedPoint.h"
+#include "KartNetTelemetry.h"
+#include "KrazyKarts.h"
+
+#if KRAZYKARTS_DRAW_DEBUG
+static TAutoConsoleVariable<int32> CVarKartDebugOverlay(
+	TEXT("KrazyKarts.DebugOverlay"),
+	0,
+	TEXT("Draws replication state above every kart.\n")
+	TEXT("0: off, 1: net role, 2: net role, unacknowledged moves, replayed moves and correction error"),
+	ECVF_Cheat);
+#endif
+
+static TAutoConsoleVariable<int32> CVarKartMoveSendRateControl(
+	TEXT("KrazyKarts.MoveSendRateControl"),
+	1,
+	TEXT("1: batch moves at a rate adapted to the owning connection's queueing, 0: send every move as soon as it is made"));
+
+// Property payloads as serialized by replication: a move is four floats, the state adds
+// rotation, translation and scale of the transform and the velocity (bytes)
+static const int32 MovePayloadBytes = 4 * sizeof(float);
+static const int32 StatePayloadBytes = (4 + 3 + 3 + 3) * sizeof(float) + MovePayloadBytes;
+
 // Sets default values for this component's properties
 UGoKartMovementReplicator::UGoKartMovementReplicator()
 {
@@ -20,7 +48,20 @@ void UGoKartMovementReplicator::BeginPlay()
 {
 	Super::BeginPlay();
 
-	MovementComponent = GetOwner()->FindComponentByClass<UGoKartMovementComponent>();
+	if (!MovementComponent)
+	{
+		TArray<UActorComponent*> Components = GetOwner()->GetComponentsByInterface(UReplicatedVehicleMovement::StaticClass());
+		MovementComponent = Components.Num() > 0 ? Components[0] : nullptr;
+	}
+
+	FKartNetTelemetry::Get().RegisterReplicator();
+}
+
+void UGoKartMovementReplicator::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	FKartNetTelemetry::Get().UnregisterReplicator();
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void UGoKartMovementReplicator::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
@@ -29,6 +70,28 @@ void UGoKartMovementReplicator::GetLifetimeReplicatedProps(TArray<FLifetimePrope
 	DOREPLIFETIME(UGoKartMovementReplicator, ServerState);
 }
 
+void UGoKartMovementReplicator::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	// Called once per replication pass of the owner, the state then goes to the connections it is relevant to,
+	// which are the ones with a channel open for it
+	UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	if (bServerStateDirty && NetDriver)
+	{
+		int32 NumConnections = 0;
+		for (UNetConnection* Connection : NetDriver->ClientConnections)
+		{
+			if (Connection && Connection->FindActorChannelRef(GetOwner()))
+			{
+				++NumConnections;
+			}
+		}
+		FKartNetTelemetry::Get().RecordStateSent(StatePayloadBytes, NumConnections);
+		bServerStateDirty = false;
+	}
+}
+
 // Called every frame
 void UGoKartMovementReplicator::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
 {
@@ -50,8 +113,12 @@ void UGoKartMovementReplicator::TickComponent(float DeltaTime, ELevelTick TickTy
 	// Client in control of the pawn 
 	if (GetOwnerRole() == ROLE_AutonomousProxy)
 	{
+		UpdateClockSync(DeltaTime);
+
 		UnackowledgedMoves.Add(LastMove);
-		Server_SendMove(LastMove);
+		PendingMoves.Add(LastMove);
+		SendPendingMoves(DeltaTime);
+		SmoothMeshOffset(DeltaTime);
 	}
 
 	// Client not in control of the pawn 
@@ -59,6 +126,95 @@ void UGoKartMovementReplicator::TickComponent(float DeltaTime, ELevelTick TickTy
 	{
 		ClientTick(DeltaTime);
 	}
+
+#if KRAZYKARTS_DRAW_DEBUG
+	int32 DebugOverlayLevel = CVarKartDebugOverlay.GetValueOnGameThread();
+	if (DebugOverlayLevel > 0)
+	{
+		DrawDebugOverlay(DebugOverlayLevel);
+	}
+#endif
+}
+
+#if KRAZYKARTS_DRAW_DEBUG
+static const TCHAR* GetRoleName(ENetRole Role)
+{
+	switch (Role)
+	{
+	case ROLE_None:
+		return TEXT("None");
+	case ROLE_SimulatedProxy:
+		return TEXT("SimulatedProxy");
+	case ROLE_AutonomousProxy:
+		return TEXT("AutonomousProxy");
+	case ROLE_Authority:
+		return TEXT("Authority");
+	default:
+		return TEXT("ERROR");
+	}
+}
+#endif
+
+void UGoKartMovementReplicator::DrawDebugOverlay(int32 Level)
+{
+#if KRAZYKARTS_DRAW_DEBUG
+	if (GetNetMode() == NM_DedicatedServer)
+	{
+		return;
+	}
+
+	FString Text = GetRoleName(GetOwnerRole());
+	if (Level > 1)
+	{
+		Text += FString::Printf(TEXT("\nUnacked %d  Replayed %d\nError %.1fcm (max %.1fcm)"),
+			UnackowledgedMoves.Num(), LastReplayCount, CorrectionStats.LastError, CorrectionStats.MaxError);
+		if (ClockSync.IsSynchronized())
+		{
+			Text += FString::Printf(TEXT("\nRTT %.0fms (min %.0fms)  Jitter %.1fms"),
+				ClockSync.SmoothedRoundTripTime * 1000, ClockSync.MinRoundTripTime * 1000, ClockSync.Jitter * 1000);
+		}
+		if (GetOwnerRole() == ROLE_AutonomousProxy)
+		{
+			Text += FString::Printf(TEXT("\nSend %.0f/s (%.1fKB/s est)  Queue %d bunches %dB\nInput latency %.0fms"),
+				SendRateControl.SendRate, SendRateControl.EstimatedBandwidth / 1024, LastReliableBunches, LastQueuedBytes, InputLatency * 1000);
+		}
+	}
+
+	DrawDebugString(GetWorld(), FVector(0, 0, 100), Text, GetOwner(), FColor::White, 0);
+#endif
+}
+
+void UGoKartMovementReplicator::ResetState()
+{
+	ServerState = FGoKartState();
+	ServerState.Transform = GetOwner()->GetActorTransform();
+	UnackowledgedMoves.Empty();
+	PendingMoves.Empty();
+	TimeSinceMovesSent = 0;
+	SendRateControl = FGoKartSendRateControl();
+	LastAcknowledgedMoveTime = -1;
+	InputLatency = 0;
+
+	ClientTimeSinceUpdate = 0;
+	ClientTimeBetweenLastUpdates = 0;
+	ClientStartTransform = ServerState.Transform;
+	ClientStartVelocity = FVector::ZeroVector;
+
+	MoveTimeBudget = FGoKartMoveTimeBudget();
+	CorrectionStats = FGoKartCorrectionStats();
+	LastReplayCount = 0;
+	LastThrottleLogTime = -1;
+	ThrottledMovesAtLastLog = 0;
+
+	ClockSync = FGoKartClockSync();
+	LastClockSyncRequestTime = -1;
+	ClockSyncRequestBudget = FGoKartRequestBudget();
+
+	MeshOffsetTimeRemaining = 0;
+	if (MeshOffsetRoot)
+	{
+		MeshOffsetRoot->SetRelativeLocationAndRotation(FVector::ZeroVector, FQuat::Identity);
+	}
 }
 
 void UGoKartMovementReplicator::UpdateServerState(const FGoKartMove& Move)
@@ -66,10 +222,18 @@ void UGoKartMovementReplicator::UpdateServerState(const FGoKartMove& Move)
 	ServerState.LastMove = Move;
 	ServerState.Transform = GetOwner()->GetActorTransform();
 	ServerState.Velocity = MovementComponent->GetVelocity();
+	ServerState.FixedState = MovementComponent->GetFixedState();
+	bServerStateDirty = true;
 }
 
 void UGoKartMovementReplicator::ClientTick(float DeltaTime)
 {
+	if (bExtrapolateSimulatedProxies)
+	{
+		ExtrapolateTick(DeltaTime);
+		return;
+	}
+	
 	ClientTimeSinceUpdate += DeltaTime;
 	
 	if (ClientTimeBetweenLastUpdates < KINDA_SMALL_NUMBER)
@@ -90,6 +254,50 @@ void UGoKartMovementReplicator::ClientTick(float DeltaTime)
 	InterpolateRotation(LerpRatio);
 }
 
+void UGoKartMovementReplicator::ExtrapolateTick(float DeltaTime)
+{
+	if (!MovementComponent)
+	{
+		return;
+	}
+
+	ClientTimeSinceUpdate += DeltaTime;
+	if (ClientTimeSinceUpdate < MaxExtrapolationTime)
+	{
+		FGoKartMove Move = ServerState.LastMove;
+		Move.DeltaTime = DeltaTime;
+		MovementComponent->SimulateMove(Move);
+	}
+
+	SmoothMeshOffset(DeltaTime);
+}
+
+void UGoKartMovementReplicator::BeginMeshOffsetSmoothing(const FTransform& MeshTransform)
+{
+	if (!MeshOffsetRoot || CorrectionSmoothingTime <= 0)
+	{
+		return;
+	}
+
+	// Leave the mesh where it was drawn and let it catch up with the corrected kart
+	MeshOffsetRoot->SetWorldTransform(MeshTransform);
+	MeshOffsetTimeRemaining = CorrectionSmoothingTime;
+}
+
+void UGoKartMovementReplicator::SmoothMeshOffset(float DeltaTime)
+{
+	if (!MeshOffsetRoot || MeshOffsetTimeRemaining <= 0)
+	{
+		return;
+	}
+
+	float Alpha = FMath::Min(DeltaTime / MeshOffsetTimeRemaining, 1.0f);
+	MeshOffsetTimeRemaining -= DeltaTime;
+
+	MeshOffsetRoot->SetRelativeLocation(FMath::Lerp(MeshOffsetRoot->GetRelativeLocation(), FVector::ZeroVector, Alpha));
+	MeshOffsetRoot->SetRelativeRotation(FQuat::Slerp(MeshOffsetRoot->GetRelativeRotation().Quaternion(), FQuat::Identity, Alpha));
+}
+
 FHermitCubicSpline UGoKartMovementReplicator::CreateSpline()
 {
 	FHermitCubicSpline Spline;
@@ -134,17 +342,28 @@ float UGoKartMovementReplicator::VelocityToDerivative()
 
 void UGoKartMovementReplicator::OnRep_ServerState()
 {
+	uint64 StartCycles = FPlatformTime::Cycles64();
+
 	switch (GetOwnerRole())
 	{
 		case ROLE_AutonomousProxy:
 			AutonomousProxy_OnRep_ServerState();
 			break;
 		case ROLE_SimulatedProxy:
-			SimulatedProxy_OnRep_ServerState();
+			if (bExtrapolateSimulatedProxies)
+			{
+				ExtrapolatedProxy_OnRep_ServerState();
+			}
+			else
+			{
+				SimulatedProxy_OnRep_ServerState();
+			}
 			break;
 		default:
 			break;
 	}
+
+	FKartNetTelemetry::Get().RecordStateReceived(StatePayloadBytes, FPlatformTime::Cycles64() - StartCycles);
 }
 
 void UGoKartMovementReplicator::AutonomousProxy_OnRep_ServerState()
@@ -154,15 +373,48 @@ void UGoKartMovementReplicator::AutonomousProxy_OnRep_ServerState()
 		return;
 	}
 	
-	GetOwner()->SetActorTransform(ServerState.Transform);
+	FTransform MeshTransform;
+	if (MeshOffsetRoot)
+	{
+		MeshTransform = MeshOffsetRoot->GetComponentTransform();
+	}
+	FTransform PredictedTransform = GetOwner()->GetActorTransform();
+	FVector PredictedVelocity = MovementComponent->GetVelocity();
+
+	GetOwner()->SetActorTransform(ServerState.Transform, false, nullptr, ETeleportType::TeleportPhysics);
 	MovementComponent->SetVelocity(ServerState.Velocity);
+#if KART_FIXED_POINT_SIMULATION
+	// Replays from the exact server state come out bit-identical to the prediction unless an input differed
+	MovementComponent->SetFixedState(ServerState.FixedState);
+#endif
+
+	// Moves are stamped with server time, so this covers batching, queueing, the trip up and the server's reply
+	if (ServerState.LastMove.StartTime > LastAcknowledgedMoveTime)
+	{
+		if (LastAcknowledgedMoveTime >= 0)
+		{
+			InputLatency = GetServerTime() - ServerState.LastMove.StartTime;
+			FKartNetTelemetry::Get().RecordInputLatency(InputLatency);
+		}
+		LastAcknowledgedMoveTime = ServerState.LastMove.StartTime;
+	}
 
 	ClearAckowledgedMoves(ServerState.LastMove);
-	
-	for (const FGoKartMove& Move : UnackowledgedMoves)
+	LastReplayCount = UnackowledgedMoves.Num();
+	FKartNetTelemetry::Get().RecordReplay(LastReplayCount);
+	MovementComponent->ReplayMoves(UnackowledgedMoves);
+
+	float Error = FVector::Dist(PredictedTransform.GetLocation(), GetOwner()->GetActorLocation());
+	CorrectionStats.Add(Error);
+
+	if (Error < MinCorrectionError)
 	{
-		MovementComponent->SimulateMove(Move);
+		GetOwner()->SetActorTransform(PredictedTransform, false, nullptr, ETeleportType::TeleportPhysics);
+		MovementComponent->SetVelocity(PredictedVelocity);
+		return;
 	}
+
+	BeginMeshOffsetSmoothing(MeshTransform);
 }
 
 void UGoKartMovementReplicator::SimulatedProxy_OnRep_ServerState()
@@ -182,7 +434,107 @@ void UGoKartMovementReplicator::SimulatedProxy_OnRep_ServerState()
 	}
 	
 	ClientStartVelocity = MovementComponent->GetVelocity();
-	GetOwner()->SetActorTransform(ServerState.Transform);
+	GetOwner()->SetActorTransform(ServerState.Transform, false, nullptr, ETeleportType::TeleportPhysics);
+}
+
+void UGoKartMovementReplicator::ExtrapolatedProxy_OnRep_ServerState()
+{
+	if (!MovementComponent)
+	{
+		return;
+	}
+
+	FTransform MeshTransform;
+	if (MeshOffsetRoot)
+	{
+		MeshTransform = MeshOffsetRoot->GetComponentTransform();
+	}
+	FVector PredictedLocation = GetOwner()->GetActorLocation();
+
+	GetOwner()->SetActorTransform(ServerState.Transform, false, nullptr, ETeleportType::TeleportPhysics);
+	MovementComponent->SetVelocity(ServerState.Velocity);
+
+	// Bring the server state up to the present by repeating the kart's last move for the time since it was made
+	const FGoKartMove& LastMove = ServerState.LastMove;
+	float ServerTime = GetServerTime();
+	ClientTimeSinceUpdate = FMath::Clamp(ServerTime - LastMove.StartTime - LastMove.DeltaTime, 0.0f, MaxExtrapolationTime);
+	if (ClientTimeSinceUpdate > 0)
+	{
+		FGoKartMove Move = LastMove;
+		Move.DeltaTime = ClientTimeSinceUpdate;
+		MovementComponent->SimulateMove(Move);
+	}
+
+	CorrectionStats.Add(FVector::Dist(PredictedLocation, GetOwner()->GetActorLocation()));
+	BeginMeshOffsetSmoothing(MeshTransform);
+}
+
+float UGoKartMovementReplicator::GetServerTime() const
+{
+	if (ClockSync.HasEstimate())
+	{
+		return ClockSync.GetServerTime();
+	}
+
+	// Only the owning client can sync, remote karts borrow the clock of the local player's kart
+	APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	APawn* LocalPawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+	UGoKartMovementReplicator* LocalReplicator = LocalPawn ? LocalPawn->FindComponentByClass<UGoKartMovementReplicator>() : nullptr;
+	if (LocalReplicator && LocalReplicator != this && LocalReplicator->ClockSync.HasEstimate())
+	{
+		return LocalReplicator->ClockSync.GetServerTime();
+	}
+
+	return GetWorld()->GetGameState()->GetServerWorldTimeSeconds();
+}
+
+float UGoKartMovementReplicator::GetMoveTime(const AActor* Kart)
+{
+	if (const UGoKartMovementReplicator* Replicator = Kart->FindComponentByClass<UGoKartMovementReplicator>())
+	{
+		return Replicator->GetServerTime();
+	}
+	return Kart->GetWorld()->GetGameState()->GetServerWorldTimeSeconds();
+}
+
+void UGoKartMovementReplicator::UpdateClockSync(float DeltaTime)
+{
+	float ClientTime = GetWorld()->GetTimeSeconds();
+
+	// Carry on from the time used so far, so the switch to synced time doesn't make it jump
+	if (!ClockSync.HasEstimate())
+	{
+		ClockSync.Seed(ClientTime, GetWorld()->GetGameState()->GetServerWorldTimeSeconds());
+	}
+	ClockSync.Tick(ClientTime, DeltaTime, MaxClockSlewRate);
+
+	float Interval = ClockSync.NumSamples < FGoKartClockSync::WindowSize ? 0.1f : ClockSyncInterval;
+	if (LastClockSyncRequestTime < 0 || ClientTime - LastClockSyncRequestTime >= Interval)
+	{
+		Server_RequestClockSync(ClientTime);
+		LastClockSyncRequestTime = ClientTime;
+	}
+}
+
+void UGoKartMovementReplicator::Server_RequestClockSync_Implementation(float ClientTime)
+{
+	// Unanswered requests only cost the client a sample
+	if (!ClockSyncRequestBudget.TryConsume(GetWorld()->GetTimeSeconds(), MaxClockSyncRequestRate, MaxClockSyncRequestBurst))
+	{
+		return;
+	}
+
+	Client_ClockSync(ClientTime, GetWorld()->GetGameState()->GetServerWorldTimeSeconds());
+}
+
+bool UGoKartMovementReplicator::Server_RequestClockSync_Validate(float ClientTime)
+{
+	return FMath::IsFinite(ClientTime);
+}
+
+void UGoKartMovementReplicator::Client_ClockSync_Implementation(float ClientTime, float ServerTime)
+{
+	ClockSync.AddSample(ClientTime, ServerTime, GetWorld()->GetTimeSeconds());
 }
 
 void UGoKartMovementReplicator::ClearAckowledgedMoves(FGoKartMove LastMove)
@@ -199,41 +551,137 @@ void UGoKartMovementReplicator::ClearAckowledgedMoves(FGoKartMove LastMove)
 }
 
 
-void UGoKartMovementReplicator::Server_SendMove_Implementation(FGoKartMove Move)
+void UGoKartMovementReplicator::SendPendingMoves(float DeltaTime)
 {
-	if (!MovementComponent)
+	TimeSinceMovesSent += DeltaTime;
+	GetSendQueue(LastReliableBunches, LastQueuedBytes);
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	const bool bQueueing = LastReliableBunches > MaxReliableBunchesInFlight || LastQueuedBytes > 0
+		|| (ClockSync.IsSynchronized() && ClockSync.SmoothedRoundTripTime - ClockSync.MinRoundTripTime > MaxQueueingDelay);
+
+	if (CVarKartMoveSendRateControl.GetValueOnGameThread() != 0)
+	{
+		const float RoundTripTime = ClockSync.IsSynchronized() ? ClockSync.SmoothedRoundTripTime : 0.1f;
+		SendRateControl.Update(bQueueing, Now, DeltaTime, RoundTripTime, MinMoveSendRate, MaxMoveSendRate, MoveSendRateIncrease);
+
+		if (TimeSinceMovesSent < 1 / SendRateControl.SendRate && PendingMoves.Num() < MaxMovesPerBatch)
+		{
+			return;
+		}
+	}
+
+	const int32 NumMoves = FMath::Min(PendingMoves.Num(), (int32)MaxMovesPerBatch);
+	if (NumMoves == 0)
 	{
 		return;
 	}
 
-	ClientSimulatedTime += Move.DeltaTime;
-	MovementComponent->SimulateMove(Move);
-	
-	UpdateServerState(Move);
+	if (NumMoves == PendingMoves.Num())
+	{
+		Server_SendMoves(PendingMoves);
+	}
+	else
+	{
+		// Only when rate control was switched off with a backlog
+		Server_SendMoves(TArray<FGoKartMove>(PendingMoves.GetData(), NumMoves));
+	}
+	PendingMoves.RemoveAt(0, NumMoves, false);
+	TimeSinceMovesSent = 0;
+
+	for (int32 i = 0; i < NumMoves; ++i)
+	{
+		FKartNetTelemetry::Get().RecordMoveSent(MovePayloadBytes);
+	}
+	FKartNetTelemetry::Get().RecordMoveBatch(NumMoves, LastReliableBunches, LastQueuedBytes);
+	SendRateControl.AddSent(NumMoves * MovePayloadBytes, Now, bQueueing);
 }
 
-bool UGoKartMovementReplicator::Server_SendMove_Validate(FGoKartMove Move)
+void UGoKartMovementReplicator::GetSendQueue(int32& OutReliableBunches, int32& OutQueuedBytes) const
 {
-	float ProposedTime = ClientSimulatedTime + Move.DeltaTime;
-	bool ClientNotRunningAhead = ProposedTime < GetWorld()->GetGameState()->GetServerWorldTimeSeconds();
+	OutReliableBunches = 0;
+	OutQueuedBytes = 0;
 
-	if (!ClientNotRunningAhead)
+	UNetConnection* Connection = GetOwner()->GetNetConnection();
+	if (!Connection)
 	{
-		UE_LOG(LogTemp, Error, TEXT("Client is running too fast."));
-		return false;
+		return;
 	}
 
-	if (Move.DeltaTime < 0)
+	// Positive once more has been sent than the connection's rate allows
+	OutQueuedBytes = FMath::Max(Connection->QueuedBits, 0) / 8;
+
+	if (UActorChannel* Channel = Connection->FindActorChannelRef(GetOwner()))
 	{
-		UE_LOG(LogTemp, Error, TEXT("Received negative time update."));
-		return false;
+		OutReliableBunches = Channel->NumOutRec;
 	}
+}
 
-	if (!Move.IsValid())
+void UGoKartMovementReplicator::Server_SendMoves_Implementation(const TArray<FGoKartMove>& Moves)
+{
+	if (!MovementComponent)
 	{
-		UE_LOG(LogTemp, Error, TEXT("Received invalid move."));
+		return;
+	}
+
+	for (const FGoKartMove& Move : Moves)
+	{
+		FKartNetTelemetry::Get().RecordMoveReceived(MovePayloadBytes);
+
+		// Moves beyond the client's time budget are dropped, the client is corrected by the next ServerState
+		if (!MoveTimeBudget.TryConsume(Move.DeltaTime, GetWorld()->GetTimeSeconds(), MaxMoveTimeBudget))
+		{
+			FKartNetTelemetry::Get().RecordThrottledMove();
+			LogThrottledMove();
+			continue;
+		}
+
+		MovementComponent->SimulateMove(Move);
+
+		UpdateServerState(Move);
+	}
+}
+
+void UGoKartMovementReplicator::LogThrottledMove()
+{
+	float Now = GetWorld()->GetTimeSeconds();
+	if (LastThrottleLogTime >= 0 && Now - LastThrottleLogTime < ThrottleLogInterval)
+	{
+		return;
+	}
+
+	UE_LOG(LogTemp, Warning, TEXT("%s: client is running too fast, throttled %u moves (drift %.3fs, max %.3fs)."),
+		*GetOwner()->GetName(), MoveTimeBudget.ThrottledMoves - ThrottledMovesAtLastLog, MoveTimeBudget.Drift, MoveTimeBudget.MaxDrift);
+
+	LastThrottleLogTime = Now;
+	ThrottledMovesAtLastLog = MoveTimeBudget.ThrottledMoves;
+}
+
+bool UGoKartMovementReplicator::Server_SendMoves_Validate(const TArray<FGoKartMove>& Moves)
+{
+	if (Moves.Num() > MaxMovesPerBatch)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Received a batch of %d moves."), Moves.Num());
+		FKartNetTelemetry::Get().RecordValidationFailure();
 		return false;
 	}
-	
+
+	for (const FGoKartMove& Move : Moves)
+	{
+		if (Move.DeltaTime < 0 || !FMath::IsFinite(Move.DeltaTime))
+		{
+			UE_LOG(LogTemp, Error, TEXT("Received negative or non-finite time update."));
+			FKartNetTelemetry::Get().RecordValidationFailure();
+			return false;
+		}
+
+		if (!Move.IsValid())
+		{
+			UE_LOG(LogTemp, Error, TEXT("Received invalid move."));
+			FKartNetTelemetry::Get().RecordValidationFailure();
+			return false;
+		}
+	}
+
 	return true;
 }
\ No newline at end of file
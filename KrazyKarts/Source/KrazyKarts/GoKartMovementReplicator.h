@@ -3,8 +3,9 @@
 #pragma once
 
 #include "CoreMinimal.h"
-#include "GoKartMovementComponent.h"
 #include "Components/ActorComponent.h"
+#include "ReplicatedVehicleMovement.h"
+#include "GoKartClockSync.h"
 #include "GoKartMovementReplicator.generated.h"
 
 USTRUCT()
@@ -20,6 +21,10 @@ struct FGoKartState
 	
 	UPROPERTY()
 	FGoKartMove LastMove;
+
+	// Only filled in when the kart is simulated in fixed point, left at zero it costs nothing to replicate
+	UPROPERTY()
+	FGoKartFixedState FixedState;
 };
 
 struct FHermitCubicSpline
@@ -40,6 +45,161 @@ struct FHermitCubicSpline
 	}
 };
 
+struct FGoKartCorrectionStats
+{
+	// Distance between the predicted and the corrected kart location (cm)
+	float LastError = 0;
+	float MaxError = 0;
+	float AverageError = 0;
+	uint32 Corrections = 0;
+
+	void Add(float Error)
+	{
+		LastError = Error;
+		MaxError = FMath::Max(MaxError, Error);
+		AverageError = Corrections == 0 ? Error : FMath::Lerp(AverageError, Error, 0.1f);
+		++Corrections;
+	}
+};
+
+struct FGoKartMoveTimeBudget
+{
+	// Simulated time the client is still allowed to spend (s)
+	float Tokens = 0;
+	float LastRefillTime = -1;
+
+	// Client simulated time minus server time elapsed since the first move (s)
+	float FirstMoveTime = -1;
+	float ClientSimulatedTime = 0;
+	float Drift = 0;
+	float MaxDrift = 0;
+
+	uint32 AcceptedMoves = 0;
+	uint32 ThrottledMoves = 0;
+
+	bool TryConsume(float DeltaTime, float ServerTime, float MaxTokens)
+	{
+		if (LastRefillTime < 0)
+		{
+			Tokens = MaxTokens;
+			FirstMoveTime = ServerTime;
+		}
+		else
+		{
+			Tokens = FMath::Min(Tokens + ServerTime - LastRefillTime, MaxTokens);
+		}
+		LastRefillTime = ServerTime;
+
+		if (DeltaTime > Tokens)
+		{
+			++ThrottledMoves;
+			return false;
+		}
+
+		Tokens -= DeltaTime;
+		ClientSimulatedTime += DeltaTime;
+		Drift = ClientSimulatedTime - (ServerTime - FirstMoveTime);
+		MaxDrift = FMath::Max(MaxDrift, FMath::Abs(Drift));
+		++AcceptedMoves;
+		return true;
+	}
+};
+
+// Token bucket over requests, for server RPCs a client could otherwise send as often as it likes
+struct FGoKartRequestBudget
+{
+	float Tokens = 0;
+	float LastRefillTime = -1;
+
+	uint32 DroppedRequests = 0;
+
+	bool TryConsume(float ServerTime, float RequestsPerSecond, float MaxTokens)
+	{
+		if (LastRefillTime < 0)
+		{
+			Tokens = MaxTokens;
+		}
+		else
+		{
+			Tokens = FMath::Min(Tokens + (ServerTime - LastRefillTime) * RequestsPerSecond, MaxTokens);
+		}
+		LastRefillTime = ServerTime;
+
+		if (Tokens < 1)
+		{
+			++DroppedRequests;
+			return false;
+		}
+
+		Tokens -= 1;
+		return true;
+	}
+};
+
+// AIMD control of how often the owning client sends its moves: the batch rate grows steadily while the link keeps up
+// and halves, at most once per round trip, when the connection starts queueing
+struct FGoKartSendRateControl
+{
+	// Move batches per second
+	float SendRate = 0;
+
+	// Move bytes the link carried in the last second without queueing, dropped to the congested rate on back off (bytes/s)
+	float EstimatedBandwidth = 0;
+
+	float LastBackoffTime = -1;
+	uint32 Backoffs = 0;
+
+	// Measured send rate
+	float WindowStartTime = -1;
+	int32 WindowBytes = 0;
+	float SentBandwidth = 0;
+
+	void Update(bool bCongested, float Now, float DeltaTime, float RoundTripTime, float MinRate, float MaxRate, float RateIncrease)
+	{
+		if (SendRate <= 0)
+		{
+			SendRate = MaxRate;
+		}
+
+		if (bCongested)
+		{
+			// The queue takes a round trip to show the effect of the last back off
+			if (LastBackoffTime < 0 || Now - LastBackoffTime >= RoundTripTime)
+			{
+				SendRate /= 2;
+				EstimatedBandwidth = SentBandwidth;
+				LastBackoffTime = Now;
+				++Backoffs;
+			}
+		}
+		else
+		{
+			SendRate += RateIncrease * DeltaTime;
+		}
+		SendRate = FMath::Clamp(SendRate, MinRate, MaxRate);
+	}
+
+	void AddSent(int32 Bytes, float Now, bool bCongested)
+	{
+		if (WindowStartTime < 0)
+		{
+			WindowStartTime = Now;
+		}
+
+		WindowBytes += Bytes;
+		if (Now - WindowStartTime >= 1)
+		{
+			SentBandwidth = WindowBytes / (Now - WindowStartTime);
+			if (!bCongested)
+			{
+				EstimatedBandwidth = FMath::Max(EstimatedBandwidth, SentBandwidth);
+			}
+			WindowStartTime = Now;
+			WindowBytes = 0;
+		}
+	}
+};
+
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
 class KRAZYKARTS_API UGoKartMovementReplicator : public UActorComponent
 {
@@ -52,50 +212,199 @@ public:
 protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:	
 	// Called every frame
 	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+
 private:
 	void ClearAckowledgedMoves(FGoKartMove LastMove);
 
+	// Sends the moves made since the last batch once the send rate allows, done by TickComponent on the owning client
+	void SendPendingMoves(float DeltaTime);
+
+	// Reliable bunches the owning connection hasn't had acknowledged yet and bytes sent over its rate limit
+	void GetSendQueue(int32& OutReliableBunches, int32& OutQueuedBytes) const;
+
 	void UpdateServerState(const FGoKartMove& Move);
 
+	void LogThrottledMove();
+
+	// Draws role and prediction stats above the kart, compiled out when debug drawing is unavailable
+	void DrawDebugOverlay(int32 Level);
+
 	void ClientTick(float DeltaTime);
+	void ExtrapolateTick(float DeltaTime);
+	void BeginMeshOffsetSmoothing(const FTransform& MeshTransform);
+	void SmoothMeshOffset(float DeltaTime);
 	FHermitCubicSpline CreateSpline();
 	void InterpolateLocation(const FHermitCubicSpline &Spline, float LerpRatio);
 	void InterpolateVelocity(const FHermitCubicSpline &Spline, float LerpRatio);
 	void InterpolateRotation(float LerpRatio);
 	float VelocityToDerivative();
 
+	// Moves made since the last batch, oldest first
 	UFUNCTION(Server, Reliable, WithValidation)
-	void Server_SendMove(FGoKartMove Move);
+	void Server_SendMoves(const TArray<FGoKartMove>& Moves);
+
+	// Unreliable so a resent packet is never mistaken for a slow round trip
+	UFUNCTION(Server, Unreliable, WithValidation)
+	void Server_RequestClockSync(float ClientTime);
+
+	UFUNCTION(Client, Unreliable)
+	void Client_ClockSync(float ClientTime, float ServerTime);
 	
 	UFUNCTION()
 	void OnRep_ServerState();
 	void AutonomousProxy_OnRep_ServerState();
 	void SimulatedProxy_OnRep_ServerState();
+	void ExtrapolatedProxy_OnRep_ServerState();
 	
 	UPROPERTY(ReplicatedUsing = OnRep_ServerState)
 	FGoKartState ServerState;
 
+	// ServerState changed since the last replication pass, for telemetry
+	bool bServerStateDirty = false;
+
 	TArray<FGoKartMove> UnackowledgedMoves;
 
+	// Made but not sent yet, a subset of UnackowledgedMoves
+	TArray<FGoKartMove> PendingMoves;
+
+	float TimeSinceMovesSent = 0;
+
+	FGoKartSendRateControl SendRateControl;
+
+	// Start time of the newest move acknowledged by the server, for input latency
+	float LastAcknowledgedMoveTime = -1;
+
+	// Time from making a move to seeing it acknowledged (s)
+	float InputLatency = 0;
+
+	int32 LastReliableBunches = 0;
+	int32 LastQueuedBytes = 0;
+
+	// Batch rate bounds, the highest is used while the link keeps up (batches per second)
+	UPROPERTY(EditAnywhere)
+	float MinMoveSendRate = 10;
+
+	UPROPERTY(EditAnywhere)
+	float MaxMoveSendRate = 60;
+
+	// How fast the batch rate climbs back while the link keeps up (batches per second, per second)
+	UPROPERTY(EditAnywhere)
+	float MoveSendRateIncrease = 10;
+
+	// Round trip time above the best one seen that counts as the link queueing (s)
+	UPROPERTY(EditAnywhere)
+	float MaxQueueingDelay = 0.05;
+
+	// Unacknowledged reliable bunches on the owning connection that count as the link queueing, the connection drops at 256
+	UPROPERTY(EditAnywhere)
+	int32 MaxReliableBunchesInFlight = 16;
+
+	// Largest batch, the server rejects larger ones
+	static const int32 MaxMovesPerBatch = 32;
+
 	float ClientTimeSinceUpdate;
 	float ClientTimeBetweenLastUpdates;
 
 	FTransform ClientStartTransform;
 	FVector ClientStartVelocity;
 
-	float ClientSimulatedTime;
+	// Simulate remote karts ahead with their last move instead of interpolating behind, so local collisions match the server
+	UPROPERTY(EditAnywhere)
+	bool bExtrapolateSimulatedProxies = false;
+
+	// Stop extrapolating a remote kart when no update has arrived for this long (s)
+	UPROPERTY(EditAnywhere)
+	float MaxExtrapolationTime = 0.5;
+
+	// Time taken for the mesh to catch up with the kart after a correction, 0 snaps instantly (s)
+	UPROPERTY(EditAnywhere)
+	float CorrectionSmoothingTime = 0.2;
+
+	float MeshOffsetTimeRemaining;
+
+	FGoKartCorrectionStats CorrectionStats;
+
+	// Moves replayed by the last reconciliation
+	int32 LastReplayCount;
+
+	FGoKartMoveTimeBudget MoveTimeBudget;
+
+	// How far a client may burst ahead of server time to absorb jitter before its moves are dropped (s)
+	UPROPERTY(EditAnywhere)
+	float MaxMoveTimeBudget = 0.25;
+
+	// Minimum time between throttling warnings for this connection (s)
+	UPROPERTY(EditAnywhere)
+	float ThrottleLogInterval = 5;
+
+	float LastThrottleLogTime = -1;
+	uint32 ThrottledMovesAtLastLog = 0;
 	
+	FGoKartClockSync ClockSync;
+
+	float LastClockSyncRequestTime = -1;
+
+	// Time between clock sync requests once the sample window is full, it fills at ten requests a second (s)
+	UPROPERTY(EditAnywhere)
+	float ClockSyncInterval = 1;
+
+	// Clock sync requests the server answers per second once a client has used up its burst
+	UPROPERTY(EditAnywhere)
+	float MaxClockSyncRequestRate = 2;
+
+	// Requests a client may make back to back, enough to fill the sample window at the start
+	UPROPERTY(EditAnywhere)
+	float MaxClockSyncRequestBurst = 10;
+
+	FGoKartRequestBudget ClockSyncRequestBudget;
+
+	// Fastest the clock estimate may run ahead or fall behind to absorb a new offset (s per s)
+	UPROPERTY(EditAnywhere)
+	float MaxClockSlewRate = 0.05;
+
+	// Corrections smaller than this keep the client's prediction, for vehicles that can only approximate a replay (cm)
+	UPROPERTY(EditAnywhere)
+	float MinCorrectionError = 0;
+
+	// Any component of the owner implementing IReplicatedVehicleMovement
 	UPROPERTY()
-	UGoKartMovementComponent* MovementComponent;
+	TScriptInterface<IReplicatedVehicleMovement> MovementComponent;
 
 	UPROPERTY()
 	USceneComponent* MeshOffsetRoot;
 
 	UFUNCTION(BlueprintCallable)
 	void SetMeshOffsetRoot(USceneComponent* Root) { MeshOffsetRoot = Root; }
+
+public:
+	const FGoKartCorrectionStats& GetCorrectionStats() const { return CorrectionStats; }
+
+	const FGoKartClockSync& GetClockSync() const { return ClockSync; }
+
+	const FGoKartSendRateControl& GetSendRateControl() const { return SendRateControl; }
+
+	// Advances the clock estimate and requests a new sample when one is due, done by TickComponent on the owning client
+	void UpdateClockSync(float DeltaTime);
+
+	// Server time estimated by the owning client's clock sync, remote karts use the local player's kart (s)
+	float GetServerTime() const;
+
+	// Time a kart's moves are stamped with when they are made: its replicator's server time, the game state's
+	// for karts without one (s)
+	static float GetMoveTime(const AActor* Kart);
+
+	void SetMinCorrectionError(float Error) { MinCorrectionError = Error; }
+
+	// Forgets all moves, corrections and server state, for karts recycled by the pool
+	void ResetState();
+
+	// Overrides the movement found on the owner, for actors with more than one IReplicatedVehicleMovement
+	void SetMovementComponent(UActorComponent* Movement) { MovementComponent = Movement; }
 };
\ No newline at end of file
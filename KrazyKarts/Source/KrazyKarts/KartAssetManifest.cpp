@@ -0,0 +1,14 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "KartAssetManifest.h"
+
+void UKartAssetManifest::GetAssetsToLoad(TArray<FSoftObjectPath>& OutAssets) const
+{
+	OutAssets.Append(Assets);
+
+	if (!IsRunningDedicatedServer())
+	{
+		OutAssets.Append(VisualAssets);
+	}
+}
@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "KartAssetManifest.generated.h"
+
+// Assets a track wants resident before karts ask for them, loaded in the background when the track begins play
+UCLASS()
+class KRAZYKARTS_API UKartAssetManifest : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	// Appends the assets to load, visual assets are left out on dedicated servers
+	void GetAssetsToLoad(TArray<FSoftObjectPath>& OutAssets) const;
+
+private:
+	// Needed by the simulation everywhere, e.g. vehicle meshes and their physics assets
+	UPROPERTY(EditAnywhere)
+	TArray<FSoftObjectPath> Assets;
+
+	// Only needed to draw the race, e.g. animation blueprints, materials and textures
+	UPROPERTY(EditAnywhere)
+	TArray<FSoftObjectPath> VisualAssets;
+};
@@ -0,0 +1,114 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "KartBench.h"
+
+#if !UE_BUILD_SHIPPING
+
+#include "Containers/Ticker.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+TUniquePtr<FKartBench> FKartBench::Active;
+
+FKartBench::FKartBench(UWorld* InWorld, const TCHAR* InName, int32 InNumPhases, float InSettleTime, float InRunTime)
+	: World(InWorld)
+	, Name(InName)
+	, NumPhases(InNumPhases)
+	, SettleTime(InSettleTime)
+	, RunTime(InRunTime)
+{
+}
+
+FKartBench::~FKartBench()
+{
+	for (int32 i = OverriddenVariables.Num() - 1; i >= 0; --i)
+	{
+		OverriddenVariables[i].Key->Set(*OverriddenVariables[i].Value, ECVF_SetByConsole);
+	}
+}
+
+void FKartBench::Start(TUniquePtr<FKartBench> Bench)
+{
+	if (Active)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s: %s is still running."), *Bench->GetName(), *Active->GetName());
+		return;
+	}
+
+	Active = MoveTemp(Bench);
+	FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&FKartBench::TickActive));
+}
+
+bool FKartBench::TickActive(float DeltaTime)
+{
+	// Ended from here rather than from inside its own tick
+	if (Active && Active->Tick(DeltaTime))
+	{
+		return true;
+	}
+	Active.Reset();
+	return false;
+}
+
+bool FKartBench::Tick(float DeltaTime)
+{
+	if (!World.IsValid())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s: the world went away, stopped."), *Name);
+		return false;
+	}
+
+	if (CurrentPhase == INDEX_NONE)
+	{
+		CurrentPhase = 0;
+		BeginPhase(CurrentPhase);
+		return true;
+	}
+
+	PhaseElapsed += DeltaTime;
+	if (!bMeasuring)
+	{
+		if (PhaseElapsed >= SettleTime)
+		{
+			bMeasuring = true;
+			BeginMeasuring(CurrentPhase);
+		}
+		return true;
+	}
+
+	MeasureFrame(DeltaTime);
+	if (PhaseElapsed < SettleTime + RunTime)
+	{
+		return true;
+	}
+
+	EndPhase(CurrentPhase);
+	if (++CurrentPhase >= NumPhases)
+	{
+		return false;
+	}
+
+	PhaseElapsed = 0;
+	bMeasuring = false;
+	BeginPhase(CurrentPhase);
+	return true;
+}
+
+void FKartBench::OverrideConsoleVariable(const TCHAR* VariableName, const FString& Value)
+{
+	IConsoleVariable* Variable = IConsoleManager::Get().FindConsoleVariable(VariableName);
+	if (!Variable)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s: no console variable %s."), *Name, VariableName);
+		return;
+	}
+
+	if (!OverriddenVariables.ContainsByPredicate([Variable](const TPair<IConsoleVariable*, FString>& Pair) { return Pair.Key == Variable; }))
+	{
+		OverriddenVariables.Emplace(Variable, Variable->GetString());
+	}
+	Variable->Set(*Value, ECVF_SetByConsole);
+}
+
+#endif
@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if !UE_BUILD_SHIPPING
+
+class IConsoleVariable;
+
+// Benchmark run over frames from the core ticker, for the KrazyKarts.Bench console commands. Each phase switches
+// what is measured, settles for SettleTime and is then measured for RunTime. One bench runs at a time, console
+// variables it overrides are put back when it ends, also when its world goes away first.
+class KRAZYKARTS_API FKartBench
+{
+public:
+	virtual ~FKartBench();
+
+	// Takes over the bench and runs its phases, refused while another one is running
+	static void Start(TUniquePtr<FKartBench> Bench);
+
+protected:
+	FKartBench(UWorld* InWorld, const TCHAR* InName, int32 InNumPhases, float InSettleTime, float InRunTime);
+
+	// Switches to the phase, before it settles
+	virtual void BeginPhase(int32 Phase) = 0;
+
+	// Clears what the bench gathers, once the phase has settled
+	virtual void BeginMeasuring(int32 Phase) {}
+
+	virtual void MeasureFrame(float DeltaTime) {}
+
+	// Reports the phase
+	virtual void EndPhase(int32 Phase) = 0;
+
+	// Restored to its value from before the bench when it ends
+	void OverrideConsoleVariable(const TCHAR* VariableName, const FString& Value);
+
+	UWorld* GetWorld() const { return World.Get(); }
+	const FString& GetName() const { return Name; }
+
+private:
+	static bool TickActive(float DeltaTime);
+	bool Tick(float DeltaTime);
+
+	static TUniquePtr<FKartBench> Active;
+
+	TWeakObjectPtr<UWorld> World;
+	FString Name;
+	int32 NumPhases;
+	float SettleTime;
+	float RunTime;
+
+	int32 CurrentPhase = INDEX_NONE;
+	float PhaseElapsed = 0;
+	bool bMeasuring = false;
+
+	TArray<TPair<IConsoleVariable*, FString>> OverriddenVariables;
+};
+
+#endif
@@ -0,0 +1,266 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "KartBroadphase.h"
+
+#include "Components/PrimitiveComponent.h"
+
+#include "GoKartMovementComponent.h"
+#include "KrazyKarts.h"
+
+DECLARE_CYCLE_STAT(TEXT("Kart Broadphase"), STAT_KrazyKartsBroadphase, STATGROUP_KrazyKarts);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Kart Contacts"), STAT_KrazyKartsContacts, STATGROUP_KrazyKarts);
+
+int32 UKartBroadphase::Register(UGoKartMovementComponent* Kart, float Radius)
+{
+	AActor* Owner = Kart->GetOwner();
+
+	FBody Body;
+	Body.Kart = Kart;
+	Body.Owner = Owner;
+	Body.Location = FVector2D(Owner->GetActorLocation());
+	Body.Radius = Radius;
+	const int32 Id = Bodies.Add(Body);
+
+	for (const FBody& Other : Bodies)
+	{
+		if (Other.Owner.IsValid() && Other.Owner != Owner)
+		{
+			SetIgnored(Owner, Other.Owner.Get(), true);
+		}
+	}
+
+	if (Radius > MaxRadius)
+	{
+		MaxRadius = Radius;
+		RebuildCells();
+	}
+	else
+	{
+		Bodies[Id].Cell = GetCell(Body.Location);
+		AddToCell(Id);
+	}
+	return Id;
+}
+
+void UKartBroadphase::Unregister(int32 Id)
+{
+	if (!Bodies.IsValidIndex(Id))
+	{
+		return;
+	}
+
+	RemoveFromCell(Id);
+	ForgetContacts(Id);
+
+	AActor* Owner = Bodies[Id].Owner.Get();
+	for (const FBody& Other : Bodies)
+	{
+		if (Owner && Other.Owner.IsValid() && Other.Owner != Owner)
+		{
+			SetIgnored(Owner, Other.Owner.Get(), false);
+		}
+	}
+
+	Bodies.RemoveAt(Id);
+}
+
+void UKartBroadphase::SetIgnored(AActor* Kart, AActor* Other, bool bIgnored)
+{
+	if (UPrimitiveComponent* Root = Cast<UPrimitiveComponent>(Kart->GetRootComponent()))
+	{
+		Root->IgnoreActorWhenMoving(Other, bIgnored);
+	}
+	if (UPrimitiveComponent* OtherRoot = Cast<UPrimitiveComponent>(Other->GetRootComponent()))
+	{
+		OtherRoot->IgnoreActorWhenMoving(Kart, bIgnored);
+	}
+}
+
+FIntPoint UKartBroadphase::GetCell(const FVector2D& Location) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
+
+void UKartBroadphase::AddToCell(int32 Id)
+{
+	Cells.FindOrAdd(Bodies[Id].Cell).Add(Id);
+}
+
+void UKartBroadphase::RemoveFromCell(int32 Id)
+{
+	if (TArray<int32, TInlineAllocator<4>>* Cell = Cells.Find(Bodies[Id].Cell))
+	{
+		Cell->RemoveSingleSwap(Id, false);
+	}
+}
+
+void UKartBroadphase::RebuildCells()
+{
+	CellSize = FMath::Max(2 * MaxRadius, 100.0f);
+	Cells.Reset();
+	for (auto It = Bodies.CreateIterator(); It; ++It)
+	{
+		It->Cell = GetCell(It->Location);
+		AddToCell(It.GetIndex());
+	}
+}
+
+void UKartBroadphase::Update(int32 Id)
+{
+	if (!Bodies.IsValidIndex(Id))
+	{
+		return;
+	}
+
+	FBody& Body = Bodies[Id];
+	AActor* Owner = Body.Owner.Get();
+	if (!Owner)
+	{
+		return;
+	}
+
+	Body.Location = FVector2D(Owner->GetActorLocation());
+	const FIntPoint Cell = GetCell(Body.Location);
+	if (Cell != Body.Cell)
+	{
+		RemoveFromCell(Id);
+		Body.Cell = Cell;
+		AddToCell(Id);
+	}
+}
+
+void UKartBroadphase::QueryOverlaps(int32 Id, TArray<FKartOverlap, TInlineAllocator<8>>& OutOverlaps)
+{
+	SCOPE_CYCLE_COUNTER(STAT_KrazyKartsBroadphase);
+
+	if (!Bodies.IsValidIndex(Id))
+	{
+		return;
+	}
+
+	if (RefreshedFrame != GFrameCounter)
+	{
+		RefreshedFrame = GFrameCounter;
+		for (auto It = Bodies.CreateIterator(); It; ++It)
+		{
+			Update(It.GetIndex());
+		}
+	}
+
+	const FBody& Body = Bodies[Id];
+	const float Reach = Body.Radius + MaxRadius;
+	const FIntPoint MinCell = GetCell(Body.Location - FVector2D(Reach, Reach));
+	const FIntPoint MaxCell = GetCell(Body.Location + FVector2D(Reach, Reach));
+
+	for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+	{
+		for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+		{
+			const TArray<int32, TInlineAllocator<4>>* Cell = Cells.Find(FIntPoint(X, Y));
+			if (!Cell)
+			{
+				continue;
+			}
+
+			for (int32 OtherId : *Cell)
+			{
+				const FBody& Other = Bodies[OtherId];
+
+				// Pooled karts wait hidden with their collision off
+				AActor* OtherOwner = Other.Owner.Get();
+				if (OtherId == Id || !Other.Kart.IsValid() || !OtherOwner || !OtherOwner->GetActorEnableCollision())
+				{
+					continue;
+				}
+
+				// Other karts may have moved since their last update this frame, use where they are now
+				const FVector2D Offset = Body.Location - FVector2D(OtherOwner->GetActorLocation());
+				const float Distance = Offset.Size();
+				const float Penetration = Body.Radius + Other.Radius - Distance;
+				if (Penetration <= 0)
+				{
+					continue;
+				}
+
+				FKartOverlap& Overlap = OutOverlaps.AddDefaulted_GetRef();
+				Overlap.Kart = Other.Kart.Get();
+				Overlap.Id = OtherId;
+				// Karts exactly on top of each other separate along X
+				Overlap.Normal = Distance > KINDA_SMALL_NUMBER ? Offset / Distance : FVector2D(1, 0);
+				Overlap.Penetration = Penetration;
+			}
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_KrazyKartsContacts, OutOverlaps.Num());
+}
+
+uint64 UKartBroadphase::GetContactKey(int32 Id, int32 OtherId)
+{
+	return ((uint64)(uint32)FMath::Min(Id, OtherId) << 32) | (uint32)FMath::Max(Id, OtherId);
+}
+
+void UKartBroadphase::MarkSimulated(int32 Id)
+{
+	if (Bodies.IsValidIndex(Id))
+	{
+		Bodies[Id].SimulatedFrame = GFrameCounter;
+	}
+}
+
+bool UKartBroadphase::IsSimulating(int32 Id) const
+{
+	return Bodies.IsValidIndex(Id) && Bodies[Id].SimulatedFrame + 1 >= GFrameCounter;
+}
+
+bool UKartBroadphase::IsContactPending(int32 Id, int32 OtherId) const
+{
+	const FContact* Contact = Contacts.Find(GetContactKey(Id, OtherId));
+	return Contact && !(Contact->bTaken[0] && Contact->bTaken[1]);
+}
+
+void UKartBroadphase::AddContact(int32 Id, int32 OtherId, const FVector& Impulse)
+{
+	FContact& Contact = Contacts.Add(GetContactKey(Id, OtherId));
+	Contact.Impulse = Id < OtherId ? Impulse : -Impulse;
+}
+
+FVector UKartBroadphase::TakeContactImpulse(int32 Id)
+{
+	FVector Impulse = FVector::ZeroVector;
+	for (TPair<uint64, FContact>& Pair : Contacts)
+	{
+		const int32 Low = (int32)(Pair.Key >> 32);
+		const int32 High = (int32)(uint32)Pair.Key;
+		const int32 Side = Id == Low ? 0 : Id == High ? 1 : INDEX_NONE;
+		if (Side != INDEX_NONE && !Pair.Value.bTaken[Side])
+		{
+			Pair.Value.bTaken[Side] = true;
+			Impulse += Side == 0 ? Pair.Value.Impulse : -Pair.Value.Impulse;
+		}
+	}
+
+	// Once both karts have their share the contact is done, a later one is resolved afresh
+	for (auto It = Contacts.CreateIterator(); It; ++It)
+	{
+		const bool bLowDone = It.Value().bTaken[0] || !IsSimulating((int32)(It.Key() >> 32));
+		const bool bHighDone = It.Value().bTaken[1] || !IsSimulating((int32)(uint32)It.Key());
+		if (bLowDone && bHighDone)
+		{
+			It.RemoveCurrent();
+		}
+	}
+	return Impulse;
+}
+
+void UKartBroadphase::ForgetContacts(int32 Id)
+{
+	for (auto It = Contacts.CreateIterator(); It; ++It)
+	{
+		if ((int32)(It.Key() >> 32) == Id || (int32)(uint32)It.Key() == Id)
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "KartBroadphase.generated.h"
+
+class UGoKartMovementComponent;
+
+// Another kart's circle overlapping the one queried, as seen from above
+struct FKartOverlap
+{
+	UGoKartMovementComponent* Kart = nullptr;
+	int32 Id = INDEX_NONE;
+
+	// From the other kart towards the queried one
+	FVector2D Normal = FVector2D::ZeroVector;
+
+	// (cm)
+	float Penetration = 0;
+};
+
+// Kart only broadphase: a hash grid over bounding circles on the ground plane. Karts ignore each other in the
+// engine's sweeps and resolve their contacts from these queries instead, which only touch the cells around the kart.
+UCLASS()
+class KRAZYKARTS_API UKartBroadphase : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Returns the id to update and query the kart with
+	int32 Register(UGoKartMovementComponent* Kart, float Radius);
+	void Unregister(int32 Id);
+
+	// Moves the kart to the cell of its owner's current location
+	void Update(int32 Id);
+
+	// Every other kart in play whose circle overlaps the kart's
+	void QueryOverlaps(int32 Id, TArray<FKartOverlap, TInlineAllocator<8>>& OutOverlaps);
+
+	// Called from each move the kart runs itself
+	void MarkSimulated(int32 Id);
+
+	// True if the kart ran a move of its own this frame or the last. Karts that don't, like interpolated proxies or
+	// vehicles on full physics, would never take their share of a contact
+	bool IsSimulating(int32 Id) const;
+
+	// True while the contact has an impulse one of the karts hasn't taken yet, it is not resolved again until then
+	bool IsContactPending(int32 Id, int32 OtherId) const;
+
+	// Starts a contact event with the impulse the first kart takes (kg m/s), the other takes it in the opposite direction
+	void AddContact(int32 Id, int32 OtherId, const FVector& Impulse);
+
+	// Sum of the impulses from the kart's contacts it hasn't taken yet, which then count as taken.
+	// Contacts whose other kart has stopped simulating are dropped, its share would never be taken
+	FVector TakeContactImpulse(int32 Id);
+
+	// Drops every contact of the kart, as when it is rolled back to before them
+	void ForgetContacts(int32 Id);
+
+private:
+	struct FBody
+	{
+		TWeakObjectPtr<UGoKartMovementComponent> Kart;
+		TWeakObjectPtr<AActor> Owner;
+		FVector2D Location;
+		float Radius;
+		FIntPoint Cell;
+		uint64 SimulatedFrame = 0;
+	};
+
+	FIntPoint GetCell(const FVector2D& Location) const;
+	void AddToCell(int32 Id);
+	void RemoveFromCell(int32 Id);
+	void SetIgnored(AActor* Kart, AActor* Other, bool bIgnored);
+
+	// Cells are at least a kart across, so a query never looks further than the neighbouring cells
+	void RebuildCells();
+
+	// Resolved once for both karts from their velocities before it, so the impulses are equal and opposite
+	// whichever of the two moves first
+	struct FContact
+	{
+		// Taken by the lower id
+		FVector Impulse = FVector::ZeroVector;
+		bool bTaken[2] = { false, false };
+	};
+
+	static uint64 GetContactKey(int32 Id, int32 OtherId);
+
+	TSparseArray<FBody> Bodies;
+	TMap<uint64, FContact> Contacts;
+	TMap<FIntPoint, TArray<int32, TInlineAllocator<4>>> Cells;
+
+	// (cm)
+	float CellSize = 400;
+	float MaxRadius = 0;
+
+	// Karts moved by replication rather than their own moves are picked up once a frame
+	uint64 RefreshedFrame = 0;
+};
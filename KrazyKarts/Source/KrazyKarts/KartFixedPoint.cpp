@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "KartFixedPoint.h"
+
+#include "Misc/Crc.h"
+
+int64 KartFixed::Sin(int64 Angle)
+{
+	// Fold into [-Pi/2, Pi/2], where a Taylor series to x^7 is accurate to better than 2e-4
+	Angle = WrapAngle(Angle);
+	if (Angle > HalfPi)
+	{
+		Angle = Pi - Angle;
+	}
+	else if (Angle < -HalfPi)
+	{
+		Angle = -Pi - Angle;
+	}
+
+	const int64 X2 = Mul(Angle, Angle);
+	const int64 X3 = Mul(X2, Angle);
+	const int64 X5 = Mul(X3, X2);
+	const int64 X7 = Mul(X5, X2);
+	return Angle - X3 / 6 + X5 / 120 - X7 / 5040;
+}
+
+void FKartFixedStep::Simulate(FGoKartFixedState& State, const FKartFixedParams& Params, int64 Throttle, int64 SteeringThrow, int64 DeltaTime)
+{
+	if (DeltaTime <= 0)
+	{
+		return;
+	}
+
+	const int64 NumSteps = FMath::Max<int64>(1, (DeltaTime + Params.MaxStepTime - 1) / Params.MaxStepTime);
+	const int64 DrivingForce = KartFixed::Mul(Params.MaxDrivingForce, Throttle);
+	const bool bResistanceHoldsKart = FMath::Abs(DrivingForce) <= Params.RollingResistanceForce;
+
+	int64 TimeLeft = DeltaTime;
+	for (int64 i = 0; i < NumSteps; ++i)
+	{
+		// Equal steps, the last one takes what the integer division left over
+		const int64 Step = i + 1 < NumSteps ? DeltaTime / NumSteps : TimeLeft;
+		TimeLeft -= Step;
+
+		const int64 Resistance = KartFixed::Mul(KartFixed::Mul(State.Speed, State.Speed), Params.DragCoefficient) + Params.RollingResistanceForce;
+		const int64 Force = DrivingForce - KartFixed::Sign(State.Speed) * Resistance;
+		int64 NewSpeed = State.Speed + KartFixed::Mul(KartFixed::Div(Force, Params.Mass), Step);
+
+		// Resistance can only bring the kart to rest, never push it backwards
+		if (bResistanceHoldsKart && (State.Speed == 0 || KartFixed::Sign(NewSpeed) != KartFixed::Sign(State.Speed)))
+		{
+			NewSpeed = 0;
+		}
+		State.Speed = NewSpeed;
+
+		const int64 Distance = KartFixed::Mul(State.Speed, Step); // m
+		State.Heading = KartFixed::WrapAngle(State.Heading + KartFixed::Mul(KartFixed::Div(Distance, Params.MinTurningRadius), SteeringThrow));
+
+		State.X += KartFixed::Mul(Distance * 100, KartFixed::Cos(State.Heading));
+		State.Y += KartFixed::Mul(Distance * 100, KartFixed::Sin(State.Heading));
+	}
+}
+
+uint32 FKartFixedStep::RunChecksum(int32 NumMoves, FGoKartFixedState& OutState)
+{
+	// Default kart properties, written out so the checksum doesn't depend on tuning
+	FKartFixedParams Params;
+	Params.Mass = 1000 * KartFixed::One;
+	Params.MaxDrivingForce = 10000 * KartFixed::One;
+	Params.MinTurningRadius = 10 * KartFixed::One;
+	Params.DragCoefficient = 16 * KartFixed::One;
+	Params.RollingResistanceForce = KartFixed::FromFloat(0.015f * 1000 * 9.8f);
+	Params.MaxStepTime = KartFixed::FromFloat(0.05f);
+
+	// Inputs sweep through full throttle, braking and both steering locks with uneven frame times
+	OutState = FGoKartFixedState();
+	uint32 Checksum = 0;
+	for (int32 i = 0; i < NumMoves; ++i)
+	{
+		const int64 Throttle = ((i * 37) % 131 - 40) * KartFixed::One / 91;
+		const int64 SteeringThrow = ((i * 53) % 101 - 50) * KartFixed::One / 50;
+		const int64 DeltaTime = 800 + (i * 7919) % 4000;
+		Simulate(OutState, Params, FMath::Clamp(Throttle, -KartFixed::One, KartFixed::One), SteeringThrow, DeltaTime);
+		Checksum = FCrc::MemCrc32(&OutState, sizeof(OutState), Checksum);
+	}
+	return Checksum;
+}
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommand SimChecksumCommand(
+	TEXT("KrazyKarts.SimChecksum"),
+	TEXT("Runs N scripted fixed point kart moves (default 100000) and prints a checksum of the final state.\n")
+	TEXT("Every build on every platform must print the same value."),
+	FConsoleCommandWithArgsDelegate::CreateStatic([](const TArray<FString>& Args)
+	{
+		int32 NumMoves = FMath::Max(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 100000, 1);
+
+		FGoKartFixedState State;
+		const uint32 Checksum = FKartFixedStep::RunChecksum(NumMoves, State);
+
+		UE_LOG(LogTemp, Log, TEXT("SimChecksum: %d moves, checksum %08X, X %lld Y %lld Speed %lld Heading %lld."),
+			NumMoves, Checksum, State.X, State.Y, State.Speed, State.Heading);
+	}));
+#endif
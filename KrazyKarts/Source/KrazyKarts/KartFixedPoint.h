@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicatedVehicleMovement.h"
+
+#ifndef KART_FIXED_POINT_SIMULATION
+#define KART_FIXED_POINT_SIMULATION 0
+#endif
+
+// Q48.16 fixed point arithmetic on int64. Only integer operations with defined rounding are used,
+// so results are bit-identical whatever the compiler, instruction set or optimization level.
+namespace KartFixed
+{
+	static const int64 One = 1 << 16;
+	static const int64 Pi = 205887;
+	static const int64 HalfPi = 102944;
+	static const int64 TwoPi = 411775;
+
+	// Scaling by a power of two is exact, so conversions from the same float agree everywhere
+	inline int64 FromFloat(float Value) { return (int64)FMath::RoundToDouble((double)Value * One); }
+	inline float ToFloat(int64 Value) { return (float)Value / (float)One; }
+
+	// Division truncates towards zero, unlike shifts of negative values it is fully defined
+	inline int64 Mul(int64 A, int64 B) { return A * B / One; }
+	inline int64 Div(int64 A, int64 B) { return B != 0 ? A * One / B : 0; }
+
+	inline int64 Sign(int64 A) { return A > 0 ? 1 : (A < 0 ? -1 : 0); }
+
+	// Angle wrapped to [-Pi, Pi)
+	inline int64 WrapAngle(int64 Angle)
+	{
+		Angle = (Angle + Pi) % TwoPi;
+		return (Angle < 0 ? Angle + TwoPi : Angle) - Pi;
+	}
+
+	KRAZYKARTS_API int64 Sin(int64 Angle);
+	inline int64 Cos(int64 Angle) { return Sin(WrapAngle(Angle + HalfPi)); }
+}
+
+// Kart constants for the fixed point step, converted once from the movement component's properties
+struct FKartFixedParams
+{
+	int64 Mass;
+	int64 MaxDrivingForce;
+	int64 MinTurningRadius;
+	int64 DragCoefficient;
+	int64 RollingResistanceForce;
+	int64 MaxStepTime;
+};
+
+// Same model as UGoKartMovementComponent::SimulateMove on flat ground: no lateral slip, heading is a yaw
+struct KRAZYKARTS_API FKartFixedStep
+{
+	static void Simulate(FGoKartFixedState& State, const FKartFixedParams& Params, int64 Throttle, int64 SteeringThrow, int64 DeltaTime);
+
+	// Runs a fixed script of moves with the default kart from rest and returns a checksum of every state along the way.
+	// Every build on every platform must return the same value
+	static uint32 RunChecksum(int32 NumMoves, FGoKartFixedState& OutState);
+};
@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "KartFixedPoint.h"
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FKartFixedPointChecksumTest, "KrazyKarts.Simulation.FixedPointChecksum",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FKartFixedPointChecksumTest::RunTest(const FString& Parameters)
+{
+	// Golden values for KrazyKarts.SimChecksum. Any build, platform or compiler that disagrees will desync in a rollback
+	// session, so these only change together with the fixed point model
+	struct FGolden
+	{
+		int32 NumMoves;
+		uint32 Checksum;
+		FGoKartFixedState State;
+	};
+	FGolden Goldens[2];
+	Goldens[0].NumMoves = 1000;
+	Goldens[0].Checksum = 0xE470A3AC;
+	Goldens[0].State.X = 3283085810;
+	Goldens[0].State.Y = -359913663;
+	Goldens[0].State.Speed = 796142;
+	Goldens[0].State.Heading = -14765;
+	Goldens[1].NumMoves = 100000;
+	Goldens[1].Checksum = 0x28328434;
+	Goldens[1].State.X = -120736311983;
+	Goldens[1].State.Y = 212442120595;
+	Goldens[1].State.Speed = 839858;
+	Goldens[1].State.Heading = 196458;
+
+	for (const FGolden& Golden : Goldens)
+	{
+		FGoKartFixedState State;
+		const uint32 Checksum = FKartFixedStep::RunChecksum(Golden.NumMoves, State);
+
+		const FString What = FString::Printf(TEXT("%d moves"), Golden.NumMoves);
+		TestEqual(*(What + TEXT(" checksum")), Checksum, Golden.Checksum);
+		TestEqual(*(What + TEXT(" X")), State.X, Golden.State.X);
+		TestEqual(*(What + TEXT(" Y")), State.Y, Golden.State.Y);
+		TestEqual(*(What + TEXT(" Speed")), State.Speed, Golden.State.Speed);
+		TestEqual(*(What + TEXT(" Heading")), State.Heading, Golden.State.Heading);
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,202 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "KartGhost.h"
+
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+
+#include "GoKartMovementReplicator.h"
+#include "KartSnapshotBroadcaster.h"
+#include "KartGhostRecorder.h"
+#include "KrazyKarts.h"
+
+DECLARE_CYCLE_STAT(TEXT("Ghost Playback"), STAT_KrazyKartsGhostPlayback, STATGROUP_KrazyKarts);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Ghosts"), STAT_KrazyKartsGhosts, STATGROUP_KrazyKarts);
+
+AKartGhost::AKartGhost()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	bReplicates = false;
+
+	StandIn = nullptr;
+}
+
+void AKartGhost::BeginPlay()
+{
+	Super::BeginPlay();
+
+	INC_DWORD_STAT(STAT_KrazyKartsGhosts);
+
+	if (!GhostName.IsEmpty())
+	{
+		Play(GhostName);
+	}
+}
+
+void AKartGhost::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	DEC_DWORD_STAT(STAT_KrazyKartsGhosts);
+
+	if (StandIn)
+	{
+		StandIn->Destroy();
+		StandIn = nullptr;
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+bool AKartGhost::Play(const FString& Name, float StartTime)
+{
+	File = FKartGhostFile::Open(Name);
+	if (!File.IsValid())
+	{
+		SetActorTickEnabled(false);
+		return false;
+	}
+
+	GhostName = Name;
+	Cursor = FKartGhostCursor(File);
+	PlaybackTime = FMath::Clamp(StartTime, 0.0f, File->GetDuration());
+	Cursor.Seek(PlaybackTime);
+	if (!Cursor.Next(From) || !Cursor.Next(To))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Ghost %s has fewer than two samples."), *Name);
+		SetActorTickEnabled(false);
+		return false;
+	}
+	Advance(PlaybackTime);
+
+	if (!StandIn)
+	{
+		// Ghosts can be driven through
+		StandIn = AKartSnapshotBroadcaster::SpawnStandIn(GetWorld(), KartClass, FTransform(From.Rotation, From.Location), false);
+	}
+
+	SetActorTickEnabled(true);
+	return true;
+}
+
+bool AKartGhost::Advance(float Time)
+{
+	while (To.Time <= Time)
+	{
+		From = To;
+		if (!Cursor.Next(To))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void AKartGhost::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (!File.IsValid() || !StandIn)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_KrazyKartsGhostPlayback);
+
+	PlaybackTime += DeltaSeconds;
+	if (!Advance(PlaybackTime))
+	{
+		if (!bLoop)
+		{
+			SetActorTickEnabled(false);
+			return;
+		}
+		Play(GhostName);
+	}
+
+	// Same spline the replicator fits for simulated proxies, ghost velocities are already in cm/s
+	const float TimeBetweenSamples = To.Time - From.Time;
+	const float LerpRatio = TimeBetweenSamples > KINDA_SMALL_NUMBER ? FMath::Clamp((PlaybackTime - From.Time) / TimeBetweenSamples, 0.0f, 1.0f) : 1.0f;
+
+	FHermitCubicSpline Spline;
+	Spline.StartLocation = From.Location;
+	Spline.StartDerivative = From.Velocity * TimeBetweenSamples;
+	Spline.TargetLocation = To.Location;
+	Spline.TargetDerivative = To.Velocity * TimeBetweenSamples;
+
+	const FQuat Rotation = FQuat::Slerp(From.Rotation.Quaternion(), To.Rotation.Quaternion(), LerpRatio);
+	StandIn->SetActorLocationAndRotation(Spline.InterpolateLocation(LerpRatio), Rotation);
+}
+
+#if !UE_BUILD_SHIPPING
+
+static FAutoConsoleCommandWithWorldAndArgs RecordGhostCommand(
+	TEXT("KrazyKarts.RecordGhost"),
+	TEXT("Starts recording the local player's kart, run again with a name (default Ghost) to save it to Saved/Ghosts"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		APlayerController* Player = World ? World->GetFirstPlayerController() : nullptr;
+		APawn* Kart = Player ? Player->GetPawn() : nullptr;
+		if (!Kart)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("RecordGhost: no local kart."));
+			return;
+		}
+
+		if (UKartGhostRecorder* Recorder = Kart->FindComponentByClass<UKartGhostRecorder>())
+		{
+			Recorder->Save(Args.Num() > 0 ? Args[0] : TEXT("Ghost"));
+			Recorder->DestroyComponent();
+			return;
+		}
+
+		UKartGhostRecorder* Recorder = NewObject<UKartGhostRecorder>(Kart);
+		Recorder->RegisterComponent();
+		UE_LOG(LogTemp, Log, TEXT("RecordGhost: recording %s."), *Kart->GetName());
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs PlayGhostCommand(
+	TEXT("KrazyKarts.PlayGhost"),
+	TEXT("Plays ghost N (default Ghost) C times (default 1), each starting S seconds (default 0.5) further into it, driving the local player's kart class"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		FString Name = Args.Num() > 0 ? Args[0] : TEXT("Ghost");
+		int32 Count = FMath::Max(Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 1, 1);
+		float Spacing = Args.Num() > 2 ? FCString::Atof(*Args[2]) : 0.5f;
+
+		APlayerController* Player = World ? World->GetFirstPlayerController() : nullptr;
+		APawn* Kart = Player ? Player->GetPawn() : nullptr;
+		if (!Kart)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("PlayGhost: no local kart to take the class from."));
+			return;
+		}
+
+		double StartTime = FPlatformTime::Seconds();
+		TSharedPtr<FKartGhostFile> File = FKartGhostFile::Open(Name);
+		if (!File.IsValid())
+		{
+			return;
+		}
+
+		for (int32 i = 0; i < Count; ++i)
+		{
+			AKartGhost* Ghost = World->SpawnActor<AKartGhost>();
+			if (!Ghost)
+			{
+				continue;
+			}
+			Ghost->SetKartClass(Kart->GetClass());
+
+			// Each ghost starts further into the lap, so they spread out along the track
+			float Duration = File->GetDuration();
+			if (!Ghost->Play(Name, Duration > 0 ? FMath::Fmod(i * Spacing, Duration) : 0))
+			{
+				Ghost->Destroy();
+				return;
+			}
+		}
+
+		UE_LOG(LogTemp, Log, TEXT("PlayGhost: started %d ghosts of %s in %.3fms, %s."), Count, *Name,
+			(FPlatformTime::Seconds() - StartTime) * 1000, File->IsMapped() ? TEXT("memory mapped") : TEXT("read into memory"));
+	}));
+#endif
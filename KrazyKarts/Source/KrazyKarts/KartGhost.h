@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "KartGhostFile.h"
+#include "KartGhost.generated.h"
+
+// Plays a recorded ghost back on a stand in kart. Local only, every machine plays its own ghosts
+UCLASS()
+class KRAZYKARTS_API AKartGhost : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AKartGhost();
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	// Starts playing Saved/Ghosts/<Name>.kghost from StartTime (s)
+	bool Play(const FString& Name, float StartTime = 0);
+
+	void SetKartClass(TSubclassOf<AActor> InKartClass) { KartClass = InKartClass; }
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	// Decodes forward until From and To straddle Time, false past the end of the ghost
+	bool Advance(float Time);
+
+	// Ghost played from BeginPlay, leave empty to start playback from code
+	UPROPERTY(EditAnywhere)
+	FString GhostName;
+
+	// Kart shown driving the ghost
+	UPROPERTY(EditAnywhere)
+	TSubclassOf<AActor> KartClass;
+
+	// Start again from the beginning at the end of the ghost
+	UPROPERTY(EditAnywhere)
+	bool bLoop = true;
+
+	TSharedPtr<FKartGhostFile> File;
+	FKartGhostCursor Cursor;
+
+	FKartGhostSample From;
+	FKartGhostSample To;
+	float PlaybackTime = 0;
+
+	UPROPERTY()
+	AActor* StandIn;
+};
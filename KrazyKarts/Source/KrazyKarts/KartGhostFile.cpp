@@ -0,0 +1,401 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "KartGhostFile.h"
+
+#include "Async/MappedFileHandle.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+#include "GoKartMovementReplicator.h"
+
+namespace
+{
+	uint32 ZigZag(int32 Value)
+	{
+		return ((uint32)Value << 1) ^ (uint32)(Value >> 31);
+	}
+
+	int32 UnZigZag(uint32 Value)
+	{
+		return (int32)(Value >> 1) ^ -(int32)(Value & 1);
+	}
+
+	void WriteVarInt(TArray<uint8>& Out, uint32 Value)
+	{
+		while (Value >= 0x80)
+		{
+			Out.Add((uint8)(Value | 0x80));
+			Value >>= 7;
+		}
+		Out.Add((uint8)Value);
+	}
+
+	bool ReadVarInt(const uint8*& Ptr, const uint8* End, uint32& OutValue)
+	{
+		OutValue = 0;
+		for (int32 Shift = 0; Shift < 35; Shift += 7)
+		{
+			if (Ptr >= End)
+			{
+				return false;
+			}
+			uint8 Byte = *Ptr++;
+			OutValue |= (uint32)(Byte & 0x7F) << Shift;
+			if (!(Byte & 0x80))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Deltas wrap like the values they come from, so any int32 round trips
+	void WriteDelta(TArray<uint8>& Out, int32 Value, int32 Previous)
+	{
+		WriteVarInt(Out, ZigZag((int32)((uint32)Value - (uint32)Previous)));
+	}
+
+	bool ReadDelta(const uint8*& Ptr, const uint8* End, int32 Previous, int32& OutValue)
+	{
+		uint32 Encoded;
+		if (!ReadVarInt(Ptr, End, Encoded))
+		{
+			return false;
+		}
+		OutValue = (int32)((uint32)Previous + (uint32)UnZigZag(Encoded));
+		return true;
+	}
+
+	void WriteUInt32(TArray<uint8>& Out, uint32 Value)
+	{
+		Out.Append((const uint8*)&Value, sizeof(Value));
+	}
+
+	uint32 ReadUInt32(const uint8* Ptr)
+	{
+		uint32 Value;
+		FMemory::Memcpy(&Value, Ptr, sizeof(Value));
+		return Value;
+	}
+
+	FKartGhostQuantizedSample Quantize(const FKartGhostSample& Sample)
+	{
+		FKartGhostQuantizedSample Quantized;
+		Quantized.Time = FMath::RoundToInt(Sample.Time * 1000);
+		for (int32 i = 0; i < 3; ++i)
+		{
+			Quantized.Location[i] = FMath::RoundToInt(Sample.Location[i] * 10);
+			Quantized.Velocity[i] = FMath::RoundToInt(Sample.Velocity[i]);
+		}
+		Quantized.Rotation[0] = FRotator::CompressAxisToShort(Sample.Rotation.Pitch);
+		Quantized.Rotation[1] = FRotator::CompressAxisToShort(Sample.Rotation.Yaw);
+		Quantized.Rotation[2] = FRotator::CompressAxisToShort(Sample.Rotation.Roll);
+		Quantized.Throttle = (int8)FMath::Clamp(FMath::RoundToInt(Sample.Throttle * 127), -127, 127);
+		Quantized.SteeringThrow = (int8)FMath::Clamp(FMath::RoundToInt(Sample.SteeringThrow * 127), -127, 127);
+		return Quantized;
+	}
+
+	FKartGhostSample Dequantize(const FKartGhostQuantizedSample& Quantized)
+	{
+		FKartGhostSample Sample;
+		Sample.Time = Quantized.Time / 1000.0f;
+		for (int32 i = 0; i < 3; ++i)
+		{
+			Sample.Location[i] = Quantized.Location[i] / 10.0f;
+			Sample.Velocity[i] = Quantized.Velocity[i];
+		}
+		Sample.Rotation.Pitch = FRotator::DecompressAxisFromShort(Quantized.Rotation[0]);
+		Sample.Rotation.Yaw = FRotator::DecompressAxisFromShort(Quantized.Rotation[1]);
+		Sample.Rotation.Roll = FRotator::DecompressAxisFromShort(Quantized.Rotation[2]);
+		Sample.Throttle = Quantized.Throttle / 127.0f;
+		Sample.SteeringThrow = Quantized.SteeringThrow / 127.0f;
+		return Sample;
+	}
+
+	void EncodeSample(TArray<uint8>& Out, const FKartGhostQuantizedSample& Sample, const FKartGhostQuantizedSample& Previous)
+	{
+		WriteDelta(Out, Sample.Time, Previous.Time);
+		for (int32 i = 0; i < 3; ++i)
+		{
+			WriteDelta(Out, Sample.Location[i], Previous.Location[i]);
+		}
+		for (int32 i = 0; i < 3; ++i)
+		{
+			WriteDelta(Out, Sample.Velocity[i], Previous.Velocity[i]);
+		}
+		// Angles take the short way round
+		for (int32 i = 0; i < 3; ++i)
+		{
+			WriteVarInt(Out, ZigZag((int16)(Sample.Rotation[i] - Previous.Rotation[i])));
+		}
+		WriteDelta(Out, Sample.Throttle, Previous.Throttle);
+		WriteDelta(Out, Sample.SteeringThrow, Previous.SteeringThrow);
+	}
+
+	bool DecodeSample(const uint8*& Ptr, const uint8* End, const FKartGhostQuantizedSample& Previous, FKartGhostQuantizedSample& OutSample)
+	{
+		bool bOk = ReadDelta(Ptr, End, Previous.Time, OutSample.Time);
+		for (int32 i = 0; i < 3; ++i)
+		{
+			bOk = bOk && ReadDelta(Ptr, End, Previous.Location[i], OutSample.Location[i]);
+		}
+		for (int32 i = 0; i < 3; ++i)
+		{
+			bOk = bOk && ReadDelta(Ptr, End, Previous.Velocity[i], OutSample.Velocity[i]);
+		}
+		for (int32 i = 0; i < 3; ++i)
+		{
+			uint32 Encoded = 0;
+			bOk = bOk && ReadVarInt(Ptr, End, Encoded);
+			OutSample.Rotation[i] = (uint16)(Previous.Rotation[i] + UnZigZag(Encoded));
+		}
+		int32 Throttle = 0;
+		int32 SteeringThrow = 0;
+		bOk = bOk && ReadDelta(Ptr, End, Previous.Throttle, Throttle) && ReadDelta(Ptr, End, Previous.SteeringThrow, SteeringThrow);
+		OutSample.Throttle = (int8)Throttle;
+		OutSample.SteeringThrow = (int8)SteeringThrow;
+		return bOk;
+	}
+}
+
+FKartGhostSample FKartGhostSample::FromState(float Time, const FGoKartState& State)
+{
+	FKartGhostSample Sample;
+	Sample.Time = Time;
+	Sample.Location = State.Transform.GetLocation();
+	Sample.Rotation = State.Transform.Rotator();
+	Sample.Velocity = State.Velocity * 100;
+	Sample.Throttle = State.LastMove.Throttle;
+	Sample.SteeringThrow = State.LastMove.SteeringThrow;
+	return Sample;
+}
+
+FKartGhostWriter::FKartGhostWriter(int32 InKeyframeInterval)
+	: KeyframeInterval(FMath::Max(InKeyframeInterval, 1))
+{
+}
+
+void FKartGhostWriter::Add(const FKartGhostSample& Sample)
+{
+	FKartGhostQuantizedSample Quantized = Quantize(Sample);
+	if (NumSamples > 0)
+	{
+		Quantized.Time = FMath::Max(Quantized.Time, Previous.Time);
+	}
+
+	if (NumSamples % KeyframeInterval == 0)
+	{
+		Index.Add((uint32)Quantized.Time);
+		Index.Add((uint32)Data.Num());
+		Previous = FKartGhostQuantizedSample();
+	}
+
+	EncodeSample(Data, Quantized, Previous);
+	Previous = Quantized;
+	++NumSamples;
+}
+
+bool FKartGhostWriter::Save(const FString& Name) const
+{
+	TArray<uint8> Bytes;
+	Bytes.Reserve(FKartGhostHeader::Size + Data.Num() + Index.Num() * sizeof(uint32));
+
+	WriteUInt32(Bytes, FKartGhostHeader::Magic);
+	WriteUInt32(Bytes, FKartGhostHeader::Version);
+	WriteUInt32(Bytes, KeyframeInterval);
+	WriteUInt32(Bytes, NumSamples);
+	WriteUInt32(Bytes, Index.Num() / 2);
+	WriteUInt32(Bytes, NumSamples > 0 ? (uint32)Previous.Time : 0);
+	WriteUInt32(Bytes, Data.Num());
+	Bytes.Append(Data);
+	for (uint32 Entry : Index)
+	{
+		WriteUInt32(Bytes, Entry);
+	}
+
+	if (FKartGhostFile::IsOpen(Name))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Ghost %s is playing and can't be overwritten."), *Name);
+		return false;
+	}
+
+	// Written aside and moved into place, so an interrupted save never leaves a truncated ghost
+	const FString Path = FKartGhostFile::GetPath(Name);
+	const FString TempPath = Path + TEXT(".tmp");
+	if (!FFileHelper::SaveArrayToFile(Bytes, *TempPath))
+	{
+		return false;
+	}
+	if (!IFileManager::Get().Move(*Path, *TempPath, true))
+	{
+		IFileManager::Get().Delete(*TempPath);
+		return false;
+	}
+	return true;
+}
+
+FKartGhostFile::~FKartGhostFile()
+{
+	// The region has to go before the file it maps
+	MappedRegion.Reset();
+	MappedFile.Reset();
+}
+
+FString FKartGhostFile::GetPath(const FString& Name)
+{
+	return FPaths::ProjectSavedDir() / TEXT("Ghosts") / (Name + TEXT(".kghost"));
+}
+
+TMap<FString, TWeakPtr<FKartGhostFile>>& FKartGhostFile::GetOpenFiles()
+{
+	static TMap<FString, TWeakPtr<FKartGhostFile>> OpenFiles;
+	return OpenFiles;
+}
+
+bool FKartGhostFile::IsOpen(const FString& Name)
+{
+	TMap<FString, TWeakPtr<FKartGhostFile>>& OpenFiles = GetOpenFiles();
+	if (OpenFiles.FindRef(Name).IsValid())
+	{
+		return true;
+	}
+
+	// No playback left, the next Open maps whatever file is there then
+	OpenFiles.Remove(Name);
+	return false;
+}
+
+TSharedPtr<FKartGhostFile> FKartGhostFile::Open(const FString& Name)
+{
+	TMap<FString, TWeakPtr<FKartGhostFile>>& OpenFiles = GetOpenFiles();
+	TSharedPtr<FKartGhostFile> File = OpenFiles.FindRef(Name).Pin();
+	if (File.IsValid())
+	{
+		return File;
+	}
+
+	File = MakeShared<FKartGhostFile>();
+	if (!File->Init(GetPath(Name)))
+	{
+		return nullptr;
+	}
+
+	OpenFiles.Add(Name, File);
+	return File;
+}
+
+bool FKartGhostFile::Init(const FString& FileName)
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	MappedFile.Reset(PlatformFile.OpenMapped(*FileName));
+	if (MappedFile.IsValid())
+	{
+		MappedRegion.Reset(MappedFile->MapRegion());
+	}
+
+	if (MappedRegion.IsValid())
+	{
+		Bytes = MappedRegion->GetMappedPtr();
+		Size = MappedRegion->GetMappedSize();
+	}
+	else if (FFileHelper::LoadFileToArray(LoadedBytes, *FileName, FILEREAD_Silent))
+	{
+		Bytes = LoadedBytes.GetData();
+		Size = LoadedBytes.Num();
+	}
+	else
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Ghost %s not found."), *FileName);
+		return false;
+	}
+
+	if (Size < FKartGhostHeader::Size)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Ghost %s is truncated."), *FileName);
+		return false;
+	}
+
+	Header.FileMagic = ReadUInt32(Bytes);
+	Header.FileVersion = ReadUInt32(Bytes + 4);
+	Header.KeyframeInterval = ReadUInt32(Bytes + 8);
+	Header.NumSamples = ReadUInt32(Bytes + 12);
+	Header.NumKeyframes = ReadUInt32(Bytes + 16);
+	Header.Duration = ReadUInt32(Bytes + 20);
+	Header.DataSize = ReadUInt32(Bytes + 24);
+
+	const int64 ExpectedSize = FKartGhostHeader::Size + (int64)Header.DataSize + (int64)Header.NumKeyframes * 2 * sizeof(uint32);
+	if (Header.FileMagic != FKartGhostHeader::Magic || Header.FileVersion != FKartGhostHeader::Version
+		|| Header.KeyframeInterval == 0 || Header.NumKeyframes == 0 || Size < ExpectedSize)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Ghost %s is not a version %u ghost or is truncated."), *FileName, FKartGhostHeader::Version);
+		return false;
+	}
+
+	return true;
+}
+
+uint32 FKartGhostFile::GetIndexEntry(int32 Keyframe, int32 Field) const
+{
+	return ReadUInt32(GetDataEnd() + (Keyframe * 2 + Field) * sizeof(uint32));
+}
+
+void FKartGhostFile::FindKeyframe(float Time, uint32& OutOffset, int32& OutSampleIndex) const
+{
+	const uint32 TimeMs = (uint32)FMath::Max(FMath::RoundToInt(Time * 1000), 0);
+
+	// Last keyframe starting at or before Time
+	int32 Low = 0;
+	int32 High = Header.NumKeyframes - 1;
+	while (Low < High)
+	{
+		int32 Middle = (Low + High + 1) / 2;
+		if (GetIndexEntry(Middle, 0) <= TimeMs)
+		{
+			Low = Middle;
+		}
+		else
+		{
+			High = Middle - 1;
+		}
+	}
+
+	OutOffset = GetIndexEntry(Low, 1);
+	OutSampleIndex = Low * Header.KeyframeInterval;
+}
+
+void FKartGhostCursor::Seek(float Time)
+{
+	if (File.IsValid())
+	{
+		File->FindKeyframe(Time, Offset, SampleIndex);
+	}
+}
+
+bool FKartGhostCursor::Next(FKartGhostSample& OutSample)
+{
+	if (!File.IsValid() || SampleIndex >= (int32)File->GetHeader().NumSamples)
+	{
+		return false;
+	}
+
+	if (SampleIndex % File->GetHeader().KeyframeInterval == 0)
+	{
+		Previous = FKartGhostQuantizedSample();
+	}
+
+	const uint8* Ptr = File->GetData() + Offset;
+	FKartGhostQuantizedSample Sample;
+	if (Offset > File->GetHeader().DataSize || !DecodeSample(Ptr, File->GetDataEnd(), Previous, Sample))
+	{
+		return false;
+	}
+
+	Offset = Ptr - File->GetData();
+	++SampleIndex;
+	Previous = Sample;
+	OutSample = Dequantize(Sample);
+	return true;
+}
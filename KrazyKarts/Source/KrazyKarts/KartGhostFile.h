@@ -0,0 +1,157 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/UniquePtr.h"
+
+struct FGoKartState;
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+// One recorded kart state, as returned by playback
+struct FKartGhostSample
+{
+	// Since the start of the recording (s)
+	float Time = 0;
+
+	FVector Location = FVector::ZeroVector;
+	FRotator Rotation = FRotator::ZeroRotator;
+
+	// (cm/s)
+	FVector Velocity = FVector::ZeroVector;
+
+	float Throttle = 0;
+	float SteeringThrow = 0;
+
+	static FKartGhostSample FromState(float Time, const FGoKartState& State);
+};
+
+// Sample as stored, every field is delta encoded against the previous sample
+struct FKartGhostQuantizedSample
+{
+	// (ms)
+	int32 Time = 0;
+
+	// (mm)
+	int32 Location[3] = {};
+
+	// (cm/s)
+	int32 Velocity[3] = {};
+
+	// FRotator::CompressAxisToShort
+	uint16 Rotation[3] = {};
+
+	int8 Throttle = 0;
+	int8 SteeringThrow = 0;
+};
+
+// Fixed size header at the start of a ghost file, followed by the sample stream and then the keyframe index
+struct FKartGhostHeader
+{
+	static const uint32 Magic = 0x5453474B; // "KGST"
+	static const uint32 Version = 1;
+	static const int32 Size = 7 * sizeof(uint32);
+
+	uint32 FileMagic = 0;
+	uint32 FileVersion = 0;
+
+	// Samples between keyframes, which are encoded against zero so playback can start there
+	uint32 KeyframeInterval = 0;
+	uint32 NumSamples = 0;
+	uint32 NumKeyframes = 0;
+
+	// (ms)
+	uint32 Duration = 0;
+
+	// Bytes of sample stream
+	uint32 DataSize = 0;
+};
+
+// Builds a ghost in memory while recording, written out in one go
+class KRAZYKARTS_API FKartGhostWriter
+{
+public:
+	explicit FKartGhostWriter(int32 InKeyframeInterval = 32);
+
+	// Samples must come in time order
+	void Add(const FKartGhostSample& Sample);
+
+	// Writes Saved/Ghosts/<Name>.kghost through a temporary file. Refused while a ghost of that name is playing,
+	// as its file is mapped
+	bool Save(const FString& Name) const;
+
+	int32 Num() const { return NumSamples; }
+
+private:
+	TArray<uint8> Data;
+
+	// Time (ms) and data offset of every keyframe
+	TArray<uint32> Index;
+
+	FKartGhostQuantizedSample Previous;
+	int32 NumSamples = 0;
+	int32 KeyframeInterval;
+};
+
+// A ghost file mapped into memory, shared by every playback of it. Samples are decoded in place by FKartGhostCursor
+class KRAZYKARTS_API FKartGhostFile
+{
+public:
+	~FKartGhostFile();
+
+	static FString GetPath(const FString& Name);
+
+	// Null when the ghost is missing or corrupt
+	static TSharedPtr<FKartGhostFile> Open(const FString& Name);
+
+	// True while any playback still holds the ghost
+	static bool IsOpen(const FString& Name);
+
+	const FKartGhostHeader& GetHeader() const { return Header; }
+	float GetDuration() const { return Header.Duration / 1000.0f; }
+
+	// False when the platform couldn't map the file and it was read into memory instead
+	bool IsMapped() const { return MappedRegion.IsValid(); }
+
+	const uint8* GetData() const { return Bytes + FKartGhostHeader::Size; }
+	const uint8* GetDataEnd() const { return GetData() + Header.DataSize; }
+
+	// Data offset and sample index of the last keyframe at or before Time
+	void FindKeyframe(float Time, uint32& OutOffset, int32& OutSampleIndex) const;
+
+private:
+	// Ghosts racing the same lap share one mapping
+	static TMap<FString, TWeakPtr<FKartGhostFile>>& GetOpenFiles();
+
+	bool Init(const FString& FileName);
+	uint32 GetIndexEntry(int32 Keyframe, int32 Field) const;
+
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+	TArray<uint8> LoadedBytes;
+
+	const uint8* Bytes = nullptr;
+	int64 Size = 0;
+	FKartGhostHeader Header;
+};
+
+// Reads samples one at a time out of a ghost file, without allocating
+class KRAZYKARTS_API FKartGhostCursor
+{
+public:
+	FKartGhostCursor() = default;
+	explicit FKartGhostCursor(const TSharedPtr<FKartGhostFile>& InFile) : File(InFile) {}
+
+	// Moves to the keyframe at or before Time, Next then returns samples from there
+	void Seek(float Time);
+
+	// False at the end of the ghost or on a corrupt sample
+	bool Next(FKartGhostSample& OutSample);
+
+private:
+	TSharedPtr<FKartGhostFile> File;
+	uint32 Offset = 0;
+	int32 SampleIndex = 0;
+	FKartGhostQuantizedSample Previous;
+};
@@ -0,0 +1,153 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "KartGhostFile.h"
+
+#include "HAL/FileManager.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/FileHelper.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	// Half the step each field is quantized to, locations also lose a little to float precision across a track
+	const float TimeTolerance = 0.0005f + KINDA_SMALL_NUMBER;
+	const float LocationTolerance = 0.05f + 0.01f;
+	const float VelocityTolerance = 0.5f + KINDA_SMALL_NUMBER;
+	const float RotationTolerance = 180.0f / 65536 + KINDA_SMALL_NUMBER;
+	const float InputTolerance = 0.5f / 127 + KINDA_SMALL_NUMBER;
+
+	const int32 KeyframeInterval = 8;
+
+	// A lap that exercises negative deltas, large jumps and yaw wrapping past 180
+	TArray<FKartGhostSample> MakeSamples()
+	{
+		TArray<FKartGhostSample> Samples;
+		FRandomStream Random(1234);
+		FKartGhostSample Sample;
+		Sample.Location = FVector(-30000, 20000, 20);
+		for (int32 i = 0; i < 100; ++i)
+		{
+			Sample.Time = i / 60.0f;
+			Sample.Velocity = FVector(Random.FRandRange(-3000, 3000), Random.FRandRange(-3000, 3000), Random.FRandRange(-50, 50));
+			Sample.Location += Sample.Velocity / 60;
+			Sample.Rotation = FRotator(Random.FRandRange(-10, 10), 170 + i * 7.3f, Random.FRandRange(-5, 5)).GetNormalized();
+			Sample.Throttle = Random.FRandRange(-1, 1);
+			Sample.SteeringThrow = Random.FRandRange(-1, 1);
+			Samples.Add(Sample);
+		}
+		// A teleport, as after a reset to the track
+		Samples[60].Location = FVector(40000, -45000, 500);
+		for (int32 i = 61; i < Samples.Num(); ++i)
+		{
+			Samples[i].Location = Samples[i - 1].Location + Samples[i].Velocity / 60;
+		}
+		return Samples;
+	}
+
+	bool SamplesMatch(FAutomationTestBase& Test, const FKartGhostSample& Expected, const FKartGhostSample& Actual, const FString& What)
+	{
+		const bool bMatch = FMath::IsNearlyEqual(Expected.Time, Actual.Time, TimeTolerance)
+			&& Expected.Location.Equals(Actual.Location, LocationTolerance)
+			&& Expected.Velocity.Equals(Actual.Velocity, VelocityTolerance)
+			&& Expected.Rotation.Equals(Actual.Rotation, RotationTolerance)
+			&& FMath::IsNearlyEqual(Expected.Throttle, Actual.Throttle, InputTolerance)
+			&& FMath::IsNearlyEqual(Expected.SteeringThrow, Actual.SteeringThrow, InputTolerance);
+		if (!bMatch)
+		{
+			Test.AddError(FString::Printf(TEXT("%s: expected %.3fs at %s, got %.3fs at %s."),
+				*What, Expected.Time, *Expected.Location.ToString(), Actual.Time, *Actual.Location.ToString()));
+		}
+		return bMatch;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FKartGhostFileRoundTripTest, "KrazyKarts.Ghost.RoundTrip",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FKartGhostFileRoundTripTest::RunTest(const FString& Parameters)
+{
+	const FString Name = TEXT("AutomationTest_RoundTrip");
+	const TArray<FKartGhostSample> Samples = MakeSamples();
+
+	FKartGhostWriter Writer(KeyframeInterval);
+	for (const FKartGhostSample& Sample : Samples)
+	{
+		Writer.Add(Sample);
+	}
+	if (!TestTrue(TEXT("Ghost saved"), Writer.Save(Name)))
+	{
+		return false;
+	}
+
+	{
+		TSharedPtr<FKartGhostFile> File = FKartGhostFile::Open(Name);
+		if (!TestTrue(TEXT("Ghost opened"), File.IsValid()))
+		{
+			return false;
+		}
+		TestEqual(TEXT("Sample count"), (int32)File->GetHeader().NumSamples, Samples.Num());
+		TestEqual(TEXT("Keyframe count"), (int32)File->GetHeader().NumKeyframes, (Samples.Num() + KeyframeInterval - 1) / KeyframeInterval);
+
+		// The mapping of a playing ghost must not be written under it
+		TestFalse(TEXT("Ghost overwritten while open"), Writer.Save(Name));
+
+		// Straight through from the start
+		FKartGhostCursor Cursor(File);
+		FKartGhostSample Sample;
+		int32 NumRead = 0;
+		while (Cursor.Next(Sample))
+		{
+			if (NumRead < Samples.Num() && !SamplesMatch(*this, Samples[NumRead], Sample, FString::Printf(TEXT("Sample %d"), NumRead)))
+			{
+				break;
+			}
+			++NumRead;
+		}
+		TestEqual(TEXT("Samples read"), NumRead, Samples.Num());
+
+		// Seeking lands on the last keyframe at or before the time and carries on from there
+		const float SeekTimes[] = { -1.0f, 0.0f, 0.2f, 7.5f / 60, 8.0f / 60, 1.0f, Samples.Last().Time, 100.0f };
+		for (float SeekTime : SeekTimes)
+		{
+			int32 Expected = 0;
+			for (int32 i = 0; i < Samples.Num(); i += KeyframeInterval)
+			{
+				if (FMath::RoundToInt(Samples[i].Time * 1000) <= FMath::Max(FMath::RoundToInt(SeekTime * 1000), 0))
+				{
+					Expected = i;
+				}
+			}
+
+			Cursor.Seek(SeekTime);
+			for (int32 i = Expected; i < FMath::Min(Expected + KeyframeInterval + 2, Samples.Num()); ++i)
+			{
+				const FString What = FString::Printf(TEXT("Seek to %.3fs, sample %d"), SeekTime, i);
+				if (!TestTrue(*What, Cursor.Next(Sample)) || !SamplesMatch(*this, Samples[i], Sample, What))
+				{
+					break;
+				}
+			}
+		}
+	}
+
+	// Cut short anywhere, the ghost is refused rather than read past its end
+	TArray<uint8> Bytes;
+	if (TestTrue(TEXT("Ghost read back"), FFileHelper::LoadFileToArray(Bytes, *FKartGhostFile::GetPath(Name))))
+	{
+		const FString TruncatedName = TEXT("AutomationTest_Truncated");
+		const int32 Cuts[] = { 0, FKartGhostHeader::Size - 1, FKartGhostHeader::Size + 3, Bytes.Num() / 2, Bytes.Num() - 1 };
+		for (int32 Cut : Cuts)
+		{
+			FFileHelper::SaveArrayToFile(TArrayView<const uint8>(Bytes.GetData(), Cut), *FKartGhostFile::GetPath(TruncatedName));
+			TestFalse(*FString::Printf(TEXT("Ghost cut to %d of %d bytes opened"), Cut, Bytes.Num()), FKartGhostFile::Open(TruncatedName).IsValid());
+		}
+		IFileManager::Get().Delete(*FKartGhostFile::GetPath(TruncatedName));
+	}
+
+	IFileManager::Get().Delete(*FKartGhostFile::GetPath(Name));
+	return true;
+}
+
+#endif
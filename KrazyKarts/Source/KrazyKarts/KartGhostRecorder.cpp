@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "KartGhostRecorder.h"
+
+#include "HAL/FileManager.h"
+
+#include "GoKartMovementReplicator.h"
+#include "ReplicatedVehicleMovement.h"
+
+UKartGhostRecorder::UKartGhostRecorder()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	// Record where the kart ended up this frame
+	PrimaryComponentTick.TickGroup = TG_PostPhysics;
+}
+
+void UKartGhostRecorder::BeginPlay()
+{
+	Super::BeginPlay();
+
+	TArray<UActorComponent*> Components = GetOwner()->GetComponentsByInterface(UReplicatedVehicleMovement::StaticClass());
+	MovementComponent = Components.Num() > 0 ? Components[0] : nullptr;
+
+	RecordSample();
+}
+
+void UKartGhostRecorder::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	RecordingTime += DeltaTime;
+	TimeSinceSample += DeltaTime;
+	if (SampleRate > 0 && TimeSinceSample >= 1 / SampleRate)
+	{
+		TimeSinceSample = FMath::Fmod(TimeSinceSample, 1 / SampleRate);
+		RecordSample();
+	}
+}
+
+void UKartGhostRecorder::RecordSample()
+{
+	FGoKartState State;
+	State.Transform = GetOwner()->GetActorTransform();
+	State.Velocity = MovementComponent ? MovementComponent->GetVelocity() : GetOwner()->GetVelocity() / 100;
+	if (MovementComponent)
+	{
+		State.LastMove = MovementComponent->GetLastMove();
+	}
+
+	Writer.Add(FKartGhostSample::FromState(RecordingTime, State));
+}
+
+bool UKartGhostRecorder::Save(const FString& Name) const
+{
+	if (!Writer.Save(Name))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Could not write ghost %s."), *FKartGhostFile::GetPath(Name));
+		return false;
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Saved ghost %s: %d samples over %.1fs, %lld bytes."), *Name, Writer.Num(), RecordingTime,
+		IFileManager::Get().FileSize(*FKartGhostFile::GetPath(Name)));
+	return true;
+}
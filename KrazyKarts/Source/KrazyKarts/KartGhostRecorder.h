@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "KartGhostFile.h"
+#include "ReplicatedVehicleMovement.h"
+#include "KartGhostRecorder.generated.h"
+
+// Records its owner's kart state for playback as a ghost by AKartGhost
+UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
+class KRAZYKARTS_API UKartGhostRecorder : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:	
+	UKartGhostRecorder();
+
+protected:
+	virtual void BeginPlay() override;
+
+public:	
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	// Writes what has been recorded so far to Saved/Ghosts/<Name>.kghost
+	bool Save(const FString& Name) const;
+
+	int32 GetNumSamples() const { return Writer.Num(); }
+
+private:
+	void RecordSample();
+
+	// Samples recorded per second, playback interpolates between them
+	UPROPERTY(EditAnywhere)
+	float SampleRate = 30;
+
+	FKartGhostWriter Writer;
+
+	float RecordingTime = 0;
+	float TimeSinceSample = 0;
+
+	// Any component of the owner implementing IReplicatedVehicleMovement
+	UPROPERTY()
+	TScriptInterface<IReplicatedVehicleMovement> MovementComponent;
+};
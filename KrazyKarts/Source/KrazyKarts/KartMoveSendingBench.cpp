@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "KartBench.h"
+
+#if !UE_BUILD_SHIPPING
+
+#include "Engine/Engine.h"
+#include "Engine/LocalPlayer.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+
+#include "KartNetTelemetry.h"
+
+// Drives the local kart over a degraded link with per-frame sends and then with rate control, logging and dumping
+// the telemetry of each run. Emulation and net speed are put back afterwards.
+class FKartMoveSendingBench : public FKartBench
+{
+public:
+	FKartMoveSendingBench(UWorld* InWorld, float RunTime, int32 PktLag, int32 PktLoss, int32 NetSpeed)
+		: FKartBench(InWorld, TEXT("BenchMoveSending"), 2, SettleTime, RunTime)
+		, Settings(FString::Printf(TEXT("PktLag %dms, PktLoss %d%%, net speed %d B/s"), PktLag, PktLoss, NetSpeed))
+	{
+		// Periodic rows stopped, so each run is one row of its own
+		OverrideConsoleVariable(TEXT("KrazyKarts.TelemetryInterval"), TEXT("0"));
+
+		GEngine->Exec(InWorld, *FString::Printf(TEXT("Net PktLag=%d"), PktLag));
+		GEngine->Exec(InWorld, *FString::Printf(TEXT("Net PktLoss=%d"), PktLoss));
+
+		// The client's net speed caps what it sends upstream, like a low MaxClientRate on the server
+		APlayerController* PlayerController = InWorld->GetFirstPlayerController();
+		if (PlayerController && PlayerController->Player)
+		{
+			PreviousNetSpeed = PlayerController->Player->CurrentNetSpeed;
+			PlayerController->SetNetSpeed(NetSpeed);
+		}
+	}
+
+	virtual ~FKartMoveSendingBench()
+	{
+		UWorld* World = GetWorld();
+		if (!World)
+		{
+			return;
+		}
+
+		GEngine->Exec(World, TEXT("Net PktLag=0"));
+		GEngine->Exec(World, TEXT("Net PktLoss=0"));
+
+		APlayerController* PlayerController = World->GetFirstPlayerController();
+		if (PlayerController && PreviousNetSpeed > 0)
+		{
+			PlayerController->SetNetSpeed(PreviousNetSpeed);
+		}
+	}
+
+protected:
+	virtual void BeginPhase(int32 Phase) override
+	{
+		OverrideConsoleVariable(TEXT("KrazyKarts.MoveSendRateControl"), FString::FromInt(Phase));
+	}
+
+	virtual void BeginMeasuring(int32 Phase) override
+	{
+		// The queues and the send rate have settled after the switch
+		FKartNetTelemetry::Get().Reset();
+	}
+
+	virtual void EndPhase(int32 Phase) override
+	{
+		FKartNetTelemetry::Get().LogMoveSummary(FString::Printf(TEXT("BenchMoveSending: MoveSendRateControl %d, %s"), Phase, *Settings));
+		FKartNetTelemetry::Get().Dump();
+	}
+
+private:
+	// Time for the send rate and the queues to settle at the start of each run (s)
+	static constexpr float SettleTime = 5;
+
+	FString Settings;
+	int32 PreviousNetSpeed = 0;
+};
+
+static FAutoConsoleCommandWithWorldAndArgs BenchMoveSendingCommand(
+	TEXT("KrazyKarts.BenchMoveSending"),
+	TEXT("Client only, while driving. Args S L P N: emulates a link with L ms lag (default 150), P% loss (default 5) and N B/s net speed (default 4000), ")
+	TEXT("then runs S seconds (default 30) with MoveSendRateControl 0 and then 1, logging queue depth and input latency and dumping telemetry after each"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (!World || World->GetNetMode() != NM_Client)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("BenchMoveSending: run it on a client connected to a server."));
+			return;
+		}
+
+		float RunTime = FMath::Max(Args.Num() > 0 ? FCString::Atof(*Args[0]) : 30.0f, 1.0f);
+		int32 PktLag = FMath::Max(Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 150, 0);
+		int32 PktLoss = FMath::Clamp(Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 5, 0, 100);
+		int32 NetSpeed = FMath::Max(Args.Num() > 3 ? FCString::Atoi(*Args[3]) : 4000, 1);
+		FKartBench::Start(MakeUnique<FKartMoveSendingBench>(World, RunTime, PktLag, PktLoss, NetSpeed));
+	}));
+
+#endif
@@ -0,0 +1,147 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "KartNetTelemetry.h"
+
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+static TAutoConsoleVariable<float> CVarKartTelemetryInterval(
+	TEXT("KrazyKarts.TelemetryInterval"),
+	0.0f,
+	TEXT("Seconds between kart replication telemetry rows written to Saved/Telemetry/KartNet.csv, 0 disables"),
+	ECVF_Default);
+
+static FAutoConsoleCommand DumpTelemetryCommand(
+	TEXT("KrazyKarts.DumpTelemetry"),
+	TEXT("Writes the kart replication telemetry gathered so far to Saved/Telemetry/KartNet.csv"),
+	FConsoleCommandDelegate::CreateStatic([]() { FKartNetTelemetry::Get().Dump(); }));
+
+FKartNetTelemetry& FKartNetTelemetry::Get()
+{
+	static FKartNetTelemetry Telemetry;
+	return Telemetry;
+}
+
+void FKartNetTelemetry::Start()
+{
+	IntervalStartTime = FPlatformTime::Seconds();
+	TickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FKartNetTelemetry::Tick), 1.0f);
+}
+
+void FKartNetTelemetry::Stop()
+{
+	FTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+	TickerHandle.Reset();
+}
+
+void FKartNetTelemetry::RecordStateReceived(int32 Bytes, uint64 OnRepCycles)
+{
+	++Current.StatesReceived;
+	Current.StateBytesReceived += Bytes;
+	Current.OnRepCycles += OnRepCycles;
+	Current.MaxOnRepCycles = FMath::Max(Current.MaxOnRepCycles, OnRepCycles);
+}
+
+void FKartNetTelemetry::RecordReplay(int32 NumMoves)
+{
+	int32 Bucket = NumMoves <= 0 ? 0 : FMath::Min(FMath::FloorLog2(NumMoves) + 1, NumReplayBuckets - 1);
+	++Current.ReplayHistogram[Bucket];
+}
+
+void FKartNetTelemetry::RecordSnapshotSent(int32 Bytes, int32 NumConnections, uint64 EncodeCycles)
+{
+	++Current.Snapshots;
+	Current.SnapshotsSent += NumConnections;
+	Current.SnapshotBytesSent += (int64)Bytes * NumConnections;
+	Current.SnapshotEncodeCycles += EncodeCycles;
+}
+
+void FKartNetTelemetry::RecordMoveBatch(int32 NumMoves, int32 ReliableBunches, int32 QueuedBytes)
+{
+	++Current.MoveBatches;
+	Current.BatchedMoves += NumMoves;
+	Current.MaxReliableBunches = FMath::Max(Current.MaxReliableBunches, ReliableBunches);
+	Current.MaxQueuedBytes = FMath::Max(Current.MaxQueuedBytes, QueuedBytes);
+}
+
+void FKartNetTelemetry::RecordInputLatency(float Seconds)
+{
+	++Current.InputLatencySamples;
+	Current.InputLatencyTotal += Seconds;
+	Current.MaxInputLatency = FMath::Max(Current.MaxInputLatency, Seconds);
+}
+
+bool FKartNetTelemetry::Tick(float DeltaTime)
+{
+	float Interval = CVarKartTelemetryInterval.GetValueOnGameThread();
+	double Now = FPlatformTime::Seconds();
+	// With periodic rows off the counters keep adding up until KrazyKarts.DumpTelemetry
+	if (Interval > 0 && Now - IntervalStartTime >= Interval)
+	{
+		Dump();
+	}
+	return true;
+}
+
+void FKartNetTelemetry::Dump()
+{
+	double Now = FPlatformTime::Seconds();
+	double Seconds = FMath::Max(Now - IntervalStartTime, 0.001);
+	double KartSeconds = FMath::Max(NumReplicators, 1) * Seconds;
+	double OnRepMicroseconds = FPlatformTime::ToMilliseconds64(Current.OnRepCycles) * 1000.0;
+	double MaxOnRepMicroseconds = FPlatformTime::ToMilliseconds64(Current.MaxOnRepCycles) * 1000.0;
+	double EncodeMicroseconds = FPlatformTime::ToMilliseconds64(Current.SnapshotEncodeCycles) * 1000.0;
+
+	FString FileName = FPaths::ProjectSavedDir() / TEXT("Telemetry") / TEXT("KartNet.csv");
+	FString Row;
+	if (IFileManager::Get().FileSize(*FileName) <= 0)
+	{
+		Row += TEXT("Time,Seconds,Replicators,MovesSent,MoveBytesSentEst,MovesReceived,MoveBytesReceivedEst,StatesSent,StateBytesSentEst,")
+			TEXT("StatesReceived,StateBytesReceivedEst,StateBytesSentPerKartPerSecondEst,MoveBytesReceivedPerKartPerSecondEst,OnRepAvgUs,OnRepMaxUs,")
+			TEXT("Replays0,Replays1,Replays2to3,Replays4to7,Replays8to15,Replays16to31,Replays32Plus,ValidationFailures,ThrottledMoves,")
+			TEXT("Snapshots,SnapshotsSent,SnapshotBytesSent,SnapshotEncodeAvgUs,")
+			TEXT("MoveBatches,MovesPerBatch,MaxReliableQueue,MaxQueuedBytes,InputLatencyAvgMs,InputLatencyMaxMs\n");
+	}
+
+	Row += FString::Printf(TEXT("%s,%.3f,%d,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%.1f,%.1f,%.2f,%.2f"),
+		*FDateTime::UtcNow().ToIso8601(), Seconds, NumReplicators,
+		Current.MovesSent, Current.MoveBytesSent, Current.MovesReceived, Current.MoveBytesReceived,
+		Current.StatesSent, Current.StateBytesSent, Current.StatesReceived, Current.StateBytesReceived,
+		Current.StateBytesSent / KartSeconds, Current.MoveBytesReceived / KartSeconds,
+		Current.StatesReceived > 0 ? OnRepMicroseconds / Current.StatesReceived : 0.0, MaxOnRepMicroseconds);
+	for (int64 Count : Current.ReplayHistogram)
+	{
+		Row += FString::Printf(TEXT(",%lld"), Count);
+	}
+	Row += FString::Printf(TEXT(",%lld,%lld,%lld,%lld,%lld,%.2f"), Current.ValidationFailures, Current.ThrottledMoves,
+		Current.Snapshots, Current.SnapshotsSent, Current.SnapshotBytesSent,
+		Current.Snapshots > 0 ? EncodeMicroseconds / Current.Snapshots : 0.0);
+	Row += FString::Printf(TEXT(",%lld,%.2f,%d,%d,%.1f,%.1f\n"),
+		Current.MoveBatches, Current.MoveBatches > 0 ? (double)Current.BatchedMoves / Current.MoveBatches : 0.0,
+		Current.MaxReliableBunches, Current.MaxQueuedBytes,
+		Current.InputLatencySamples > 0 ? Current.InputLatencyTotal * 1000 / Current.InputLatencySamples : 0.0, Current.MaxInputLatency * 1000.0);
+
+	FFileHelper::SaveStringToFile(Row, *FileName, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), FILEWRITE_Append);
+
+	Current = FCounters();
+	IntervalStartTime = Now;
+}
+
+void FKartNetTelemetry::Reset()
+{
+	Current = FCounters();
+	IntervalStartTime = FPlatformTime::Seconds();
+}
+
+void FKartNetTelemetry::LogMoveSummary(const FString& Label) const
+{
+	double Seconds = FMath::Max(FPlatformTime::Seconds() - IntervalStartTime, 0.001);
+	UE_LOG(LogTemp, Log, TEXT("%s: %.1f moves/s in %.1f batches/s (%.2f moves per batch), max reliable queue %d, max queued bytes %d, input latency avg %.1fms max %.1fms."),
+		*Label, Current.MovesSent / Seconds, Current.MoveBatches / Seconds,
+		Current.MoveBatches > 0 ? (double)Current.BatchedMoves / Current.MoveBatches : 0.0,
+		Current.MaxReliableBunches, Current.MaxQueuedBytes,
+		Current.InputLatencySamples > 0 ? Current.InputLatencyTotal * 1000 / Current.InputLatencySamples : 0.0, Current.MaxInputLatency * 1000.0);
+}
@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+
+// Replication counters for every kart replicator in the process, appended to
+// Saved/Telemetry/KartNet.csv every KrazyKarts.TelemetryInterval seconds.
+// Move and state byte counts are estimates, the payload size of the properties times the moves or states sent,
+// before packet headers, bit packing and delta replication. Snapshot bytes are the encoded size.
+class KRAZYKARTS_API FKartNetTelemetry
+{
+public:
+	static FKartNetTelemetry& Get();
+
+	void Start();
+	void Stop();
+
+	void RegisterReplicator() { ++NumReplicators; }
+	void UnregisterReplicator() { --NumReplicators; }
+
+	void RecordMoveSent(int32 Bytes) { ++Current.MovesSent; Current.MoveBytesSent += Bytes; }
+	void RecordMoveReceived(int32 Bytes) { ++Current.MovesReceived; Current.MoveBytesReceived += Bytes; }
+	void RecordStateSent(int32 Bytes, int32 NumConnections) { Current.StatesSent += NumConnections; Current.StateBytesSent += (int64)Bytes * NumConnections; }
+	void RecordStateReceived(int32 Bytes, uint64 OnRepCycles);
+	void RecordReplay(int32 NumMoves);
+	void RecordValidationFailure() { ++Current.ValidationFailures; }
+	void RecordThrottledMove() { ++Current.ThrottledMoves; }
+
+	// Queue depths as seen by the owning client when it sends a batch
+	void RecordMoveBatch(int32 NumMoves, int32 ReliableBunches, int32 QueuedBytes);
+	void RecordInputLatency(float Seconds);
+
+	// A snapshot is encoded once and then sent to every snapshot viewer
+	void RecordSnapshotSent(int32 Bytes, int32 NumConnections, uint64 EncodeCycles);
+
+	// Appends the counters gathered since the last dump and starts a new interval
+	void Dump();
+
+	// Drops the counters gathered so far and starts a new interval
+	void Reset();
+
+	// Logs the move sending counters of the current interval: batches, queue depth and input latency
+	void LogMoveSummary(const FString& Label) const;
+
+private:
+	static const int32 NumReplayBuckets = 7;
+
+	struct FCounters
+	{
+		int64 MovesSent = 0;
+		int64 MoveBytesSent = 0;
+		int64 MovesReceived = 0;
+		int64 MoveBytesReceived = 0;
+		int64 StatesSent = 0;
+		int64 StateBytesSent = 0;
+		int64 StatesReceived = 0;
+		int64 StateBytesReceived = 0;
+		uint64 OnRepCycles = 0;
+		uint64 MaxOnRepCycles = 0;
+		// Replays of 0, 1, 2-3, 4-7, 8-15, 16-31 and 32+ moves
+		int64 ReplayHistogram[NumReplayBuckets] = {};
+		int64 ValidationFailures = 0;
+		int64 ThrottledMoves = 0;
+		int64 Snapshots = 0;
+		int64 SnapshotsSent = 0;
+		int64 SnapshotBytesSent = 0;
+		uint64 SnapshotEncodeCycles = 0;
+		int64 MoveBatches = 0;
+		int64 BatchedMoves = 0;
+		int32 MaxReliableBunches = 0;
+		int32 MaxQueuedBytes = 0;
+		int64 InputLatencySamples = 0;
+		double InputLatencyTotal = 0;
+		float MaxInputLatency = 0;
+	};
+
+	bool Tick(float DeltaTime);
+
+	FCounters Current;
+	int32 NumReplicators = 0;
+	double IntervalStartTime = 0;
+	FDelegateHandle TickerHandle;
+};
@@ -0,0 +1,252 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "KartRaceSession.h"
+
+#include "Engine/Level.h"
+#include "Engine/LevelStreamingDynamic.h"
+#include "Net/UnrealNetwork.h"
+
+#include "KartSnapshotBroadcaster.h"
+#include "KartTrack.h"
+#include "KrazyKarts.h"
+
+DECLARE_CYCLE_STAT(TEXT("Race Standings"), STAT_KrazyKartsRaceStandings, STATGROUP_KrazyKarts);
+
+AKartRaceSession::AKartRaceSession()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	bReplicates = true;
+	bAlwaysRelevant = false;
+	NetUpdateFrequency = 10;
+
+	SessionId = 0;
+	Origin = FVector::ZeroVector;
+	SnapshotBroadcaster = nullptr;
+}
+
+void AKartRaceSession::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+	DOREPLIFETIME(AKartRaceSession, SessionId);
+	DOREPLIFETIME(AKartRaceSession, Origin);
+	DOREPLIFETIME(AKartRaceSession, Level);
+	DOREPLIFETIME(AKartRaceSession, LevelInstanceName);
+	DOREPLIFETIME(AKartRaceSession, Standings);
+}
+
+bool AKartRaceSession::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	const AKrazyKartsGameState* RaceState = GetWorld()->GetGameState<AKrazyKartsGameState>();
+	return !RaceState || RaceState->GetSessionId(RealViewer) == SessionId;
+}
+
+void AKartRaceSession::Init(int32 InSessionId, const FVector& InOrigin, TSoftObjectPtr<UWorld> InLevel)
+{
+	SessionId = InSessionId;
+	Origin = InOrigin;
+	Level = InLevel;
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.Owner = this;
+	SnapshotBroadcaster = GetWorld()->SpawnActor<AKartSnapshotBroadcaster>(SpawnParams);
+	if (SnapshotBroadcaster)
+	{
+		SnapshotBroadcaster->Init(this);
+	}
+
+	if (!Level.IsNull())
+	{
+		LevelInstanceName = FString::Printf(TEXT("%s_Race%d"), *Level.GetAssetName(), SessionId);
+		LoadLevelInstance();
+	}
+}
+
+void AKartRaceSession::OnRep_LevelInstanceName()
+{
+	LoadLevelInstance();
+}
+
+void AKartRaceSession::LoadLevelInstance()
+{
+	if (LevelInstance || Level.IsNull() || LevelInstanceName.IsEmpty())
+	{
+		return;
+	}
+
+	bool bSuccess = false;
+	LevelInstance = ULevelStreamingDynamic::LoadLevelInstanceBySoftObjectPtr(this, Level, Origin, FRotator::ZeroRotator, bSuccess, LevelInstanceName);
+	if (!bSuccess)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Race %d: could not load an instance of %s."), SessionId, *Level.ToString());
+	}
+}
+
+void AKartRaceSession::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (AKrazyKartsGameState* RaceState = GetWorld()->GetGameState<AKrazyKartsGameState>())
+	{
+		RaceState->AddSession(this);
+	}
+}
+
+void AKartRaceSession::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (AKrazyKartsGameState* RaceState = GetWorld()->GetGameState<AKrazyKartsGameState>())
+	{
+		RaceState->RemoveSession(this);
+	}
+
+	if (SnapshotBroadcaster)
+	{
+		SnapshotBroadcaster->Destroy();
+		SnapshotBroadcaster = nullptr;
+	}
+
+	if (LevelInstance)
+	{
+		LevelInstance->SetIsRequestingUnloadAndRemoval(true);
+		LevelInstance = nullptr;
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+AKartTrack* AKartRaceSession::FindSessionTrack() const
+{
+	if (Level.IsNull())
+	{
+		return AKartTrack::FindTrack(GetWorld());
+	}
+
+	ULevel* LoadedLevel = LevelInstance ? LevelInstance->GetLoadedLevel() : nullptr;
+	if (!LoadedLevel || !LevelInstance->IsLevelVisible())
+	{
+		return nullptr;
+	}
+
+	return AKartTrack::FindTrackInLevel(LoadedLevel);
+}
+
+void AKartRaceSession::RegisterKart(AActor* Kart)
+{
+	if (!Kart || Karts.ContainsByPredicate([Kart](const FKartRaceProgress& Entry) { return Entry.Kart == Kart; }))
+	{
+		return;
+	}
+
+	FKartRaceProgress& Entry = Karts.AddDefaulted_GetRef();
+	Entry.Kart = Kart;
+}
+
+void AKartRaceSession::UnregisterKart(AActor* Kart)
+{
+	Karts.RemoveAllSwap([Kart](const FKartRaceProgress& Entry) { return Entry.Kart == Kart; });
+}
+
+void AKartRaceSession::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (!HasAuthority())
+	{
+		return;
+	}
+
+	if (!Track)
+	{
+		Track = FindSessionTrack();
+		if (!Track)
+		{
+			return;
+		}
+		OnReady.Broadcast(this);
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_KrazyKartsRaceStandings);
+
+	Karts.RemoveAllSwap([](const FKartRaceProgress& Entry) { return !Entry.Kart.IsValid(); });
+	for (FKartRaceProgress& Entry : Karts)
+	{
+		UpdateProgress(Entry);
+	}
+	UpdateStandings();
+}
+
+void AKartRaceSession::UpdateProgress(FKartRaceProgress& Entry)
+{
+	const float Length = Track->GetLength();
+	if (Length <= 0)
+	{
+		return;
+	}
+
+	// Karts move a fraction of a segment per tick, so only the neighbourhood of the last segment is searched
+	FKartTrackProjection Projection = Track->ProjectPoint(Entry.Kart->GetActorLocation(), Entry.Segment);
+	if (Projection.Segment == INDEX_NONE)
+	{
+		return;
+	}
+
+	if (Entry.Segment == INDEX_NONE)
+	{
+		// Karts on the grid behind the start line haven't started their first lap
+		Entry.Progress = Projection.Distance > Length / 2 ? Projection.Distance - Length : Projection.Distance;
+	}
+	else
+	{
+		float Delta = Projection.Distance - Entry.LastDistance;
+		if (Delta > Length / 2)
+		{
+			Delta -= Length;
+		}
+		else if (Delta < -Length / 2)
+		{
+			Delta += Length;
+		}
+		Entry.Progress += Delta;
+	}
+	Entry.Segment = Projection.Segment;
+	Entry.LastDistance = Projection.Distance;
+
+	// Checkpoints stay passed when driving backwards, but progress doesn't
+	const float CheckpointSpacing = Length / FMath::Max(1, Track->GetNumCheckpoints());
+	while (Entry.Progress >= (Entry.CheckpointsPassed + 1) * CheckpointSpacing)
+	{
+		++Entry.CheckpointsPassed;
+	}
+}
+
+void AKartRaceSession::UpdateStandings()
+{
+	Order.SetNumUninitialized(Karts.Num());
+	for (int32 i = 0; i < Karts.Num(); ++i)
+	{
+		Order[i] = i;
+	}
+	Order.Sort([this](int32 A, int32 B) { return Karts[A].Progress > Karts[B].Progress; });
+
+	const float Length = Track->GetLength();
+	const int32 NumCheckpoints = FMath::Max(1, Track->GetNumCheckpoints());
+
+	Standings.SetNum(Karts.Num());
+	for (int32 Position = 0; Position < Order.Num(); ++Position)
+	{
+		const FKartRaceProgress& Entry = Karts[Order[Position]];
+
+		FKartRaceStanding Standing;
+		Standing.Kart = Entry.Kart.Get();
+		Standing.Lap = (uint8)FMath::Clamp(Entry.CheckpointsPassed / NumCheckpoints, 0, 255);
+		Standing.Checkpoint = (uint8)(Entry.CheckpointsPassed % NumCheckpoints);
+		float LapFraction = FMath::Fmod(FMath::Max(Entry.Progress, 0.0f), Length) / Length;
+		Standing.LapProgress = (uint16)FMath::Clamp(FMath::RoundToInt(LapFraction * 65535), 0, 65535);
+
+		// Only touch rows that changed so unchanged entries don't dirty the replicated array
+		if (!(Standings[Position] == Standing))
+		{
+			Standings[Position] = Standing;
+		}
+	}
+}
@@ -0,0 +1,90 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "KrazyKartsGameState.h"
+#include "KartRaceSession.generated.h"
+
+class AKartTrack;
+class AKartSnapshotBroadcaster;
+class ULevelStreamingDynamic;
+class AKartRaceSession;
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnKartRaceSessionReady, AKartRaceSession*);
+
+// One of the races sharing the server process. Each race drives its own instance of the race level at its
+// own origin, so karts of different races never meet, and only players in the race receive its karts and standings
+UCLASS()
+class KRAZYKARTS_API AKartRaceSession : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	AKartRaceSession();
+
+	virtual void BeginPlay() override;
+	virtual void Tick(float DeltaSeconds) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
+
+	/** Server only. Without a level the race uses the track of the persistent level */
+	void Init(int32 InSessionId, const FVector& InOrigin, TSoftObjectPtr<UWorld> InLevel);
+
+	/** Start tracking a kart's race progress, server only */
+	void RegisterKart(AActor* Kart);
+	void UnregisterKart(AActor* Kart);
+
+	int32 GetSessionId() const { return SessionId; }
+	const FVector& GetOrigin() const { return Origin; }
+	AKartTrack* GetTrack() const { return Track; }
+
+	/** Standings ordered by race position */
+	const TArray<FKartRaceStanding>& GetStandings() const { return Standings; }
+
+	/** Broadcast on the server once the race's track has streamed in */
+	FOnKartRaceSessionReady OnReady;
+
+private:
+	UFUNCTION()
+	void OnRep_LevelInstanceName();
+
+	void LoadLevelInstance();
+	AKartTrack* FindSessionTrack() const;
+
+	void UpdateProgress(FKartRaceProgress& Entry);
+	void UpdateStandings();
+
+	UPROPERTY(Replicated)
+	int32 SessionId;
+
+	UPROPERTY(Replicated)
+	FVector Origin;
+
+	UPROPERTY(Replicated)
+	TSoftObjectPtr<UWorld> Level;
+
+	/** Same on server and clients, so actors in the instance resolve over the network */
+	UPROPERTY(ReplicatedUsing = OnRep_LevelInstanceName)
+	FString LevelInstanceName;
+
+	UPROPERTY()
+	ULevelStreamingDynamic* LevelInstance;
+
+	/** Replicated as a single array rather than per kart properties */
+	UPROPERTY(Replicated)
+	TArray<FKartRaceStanding> Standings;
+
+	TArray<FKartRaceProgress> Karts;
+
+	/** Indices into Karts, reused each tick */
+	TArray<int32> Order;
+
+	UPROPERTY()
+	AKartTrack* Track;
+
+	/** Server only */
+	UPROPERTY()
+	AKartSnapshotBroadcaster* SnapshotBroadcaster;
+};
@@ -0,0 +1,394 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "KartRollbackManager.h"
+
+#include "EngineUtils.h"
+#include "GameFramework/GameStateBase.h"
+#include "Net/UnrealNetwork.h"
+
+#include "GoKart.h"
+
+AKartRollbackManager::AKartRollbackManager()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	bReplicates = true;
+	bAlwaysRelevant = true;
+	NetUpdateFrequency = 1;
+}
+
+AKartRollbackManager* AKartRollbackManager::Find(UWorld* World)
+{
+	if (!World)
+	{
+		return nullptr;
+	}
+
+	TActorIterator<AKartRollbackManager> It(World);
+	return It ? *It : nullptr;
+}
+
+void AKartRollbackManager::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+	DOREPLIFETIME(AKartRollbackManager, Session);
+}
+
+void AKartRollbackManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	EndSession();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AKartRollbackManager::StartSession(const TArray<AGoKart*>& Karts, float StartDelay)
+{
+	if (!HasAuthority())
+	{
+		return;
+	}
+
+	EndSession();
+
+	Session = FKartRollbackSession();
+	for (AGoKart* Kart : Karts)
+	{
+		if (Kart && Session.Karts.Num() < MaxKarts)
+		{
+			Session.Karts.Add(Kart);
+			Session.StartTransforms.Add(Kart->GetActorTransform());
+		}
+	}
+	Session.StartTime = GetServerTime() + StartDelay;
+	LastStartDelay = StartDelay;
+
+	ForceNetUpdate();
+	BeginSession();
+}
+
+void AKartRollbackManager::StopSession()
+{
+	if (!HasAuthority())
+	{
+		return;
+	}
+
+	Session = FKartRollbackSession();
+	ForceNetUpdate();
+	EndSession();
+}
+
+void AKartRollbackManager::RestartSession(AGoKart* Kart, float SessionStartTime)
+{
+	if (!HasAuthority() || SessionStartTime != Session.StartTime || !Session.Karts.Contains(Kart))
+	{
+		return;
+	}
+
+	UE_LOG(LogTemp, Warning, TEXT("Rollback session reached %s's client late, restarting it."), *Kart->GetName());
+	TArray<AGoKart*> Karts = Session.Karts;
+	StartSession(Karts, FMath::Clamp(2 * LastStartDelay, 0.5f, MaxStartDelay));
+}
+
+void AKartRollbackManager::OnRep_Session()
+{
+	EndSession();
+	BeginSession();
+}
+
+void AKartRollbackManager::BeginSession()
+{
+	if (Session.Karts.Num() == 0 || Session.Karts.Num() != Session.StartTransforms.Num())
+	{
+		return;
+	}
+
+	// Kart references resolve as the karts replicate, OnRep_Session comes again once they have
+	TArray<UGoKartMovementComponent*> Movements;
+	for (AGoKart* Kart : Session.Karts)
+	{
+		UGoKartMovementComponent* Movement = Kart ? Kart->GetKartMovement() : nullptr;
+		if (!Movement)
+		{
+			return;
+		}
+		Movements.Add(Movement);
+	}
+
+	// Inputs of the frames already played are gone, from the start transforms this machine would never converge
+	// with the others. The karts stay with their replicators until the restarted session arrives
+	int32 StartFrame = FMath::Max(0, FMath::FloorToInt((GetServerTime() - Session.StartTime) / FrameTime));
+	if (StartFrame > 0 && !HasAuthority())
+	{
+		AGoKart* const* LocalKart = Session.Karts.FindByPredicate([](AGoKart* Kart) { return Kart->IsLocallyControlled(); });
+		UE_LOG(LogTemp, Warning, TEXT("Rollback session started %d frames before it arrived, %s."), StartFrame,
+			LocalKart ? TEXT("asking the server for a restart") : TEXT("not following it"));
+		if (LocalKart)
+		{
+			(*LocalKart)->Server_RequestRollbackRestart(Session.StartTime);
+		}
+		return;
+	}
+
+	LocalReplicator = nullptr;
+	for (int32 i = 0; i < Session.Karts.Num(); ++i)
+	{
+		AGoKart* Kart = Session.Karts[i];
+		UGoKartMovementReplicator* Replicator = Kart->FindComponentByClass<UGoKartMovementReplicator>();
+
+		// The manager steps the karts from here on, every machine from the same start
+		Movements[i]->SetComponentTickEnabled(false);
+		Movements[i]->ResetState();
+		Kart->SetActorTransform(Session.StartTransforms[i], false, nullptr, ETeleportType::TeleportPhysics);
+		if (Replicator)
+		{
+			Replicator->SetComponentTickEnabled(false);
+			Replicator->ResetState();
+			if (Kart->IsLocallyControlled())
+			{
+				LocalReplicator = Replicator;
+			}
+		}
+	}
+
+	Simulation.Init(Movements, FrameTime, MaxRollbackFrames, StartFrame);
+}
+
+void AKartRollbackManager::EndSession()
+{
+	if (!Simulation.IsActive())
+	{
+		return;
+	}
+	Simulation.Reset();
+	LocalReplicator = nullptr;
+
+	for (TActorIterator<AGoKart> It(GetWorld()); It; ++It)
+	{
+		if (It->IsHidden())
+		{
+			// Pooled karts stay asleep
+			continue;
+		}
+		if (UGoKartMovementComponent* Movement = It->GetKartMovement())
+		{
+			Movement->SetComponentTickEnabled(true);
+		}
+		if (UGoKartMovementReplicator* Replicator = It->FindComponentByClass<UGoKartMovementReplicator>())
+		{
+			Replicator->SetComponentTickEnabled(true);
+		}
+	}
+}
+
+float AKartRollbackManager::GetServerTime() const
+{
+	if (LocalReplicator)
+	{
+		return LocalReplicator->GetServerTime();
+	}
+	return GetWorld()->GetGameState()->GetServerWorldTimeSeconds();
+}
+
+void AKartRollbackManager::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!Simulation.IsActive())
+	{
+		return;
+	}
+
+	// The replicator no longer ticks, but its clock is still needed to pace the frames
+	if (LocalReplicator && !HasAuthority())
+	{
+		LocalReplicator->UpdateClockSync(DeltaTime);
+	}
+
+	Simulation.Rollback();
+
+	int32 TargetFrame = FMath::FloorToInt((GetServerTime() - Session.StartTime) / FrameTime);
+	for (int32 Steps = 0; Simulation.GetFrame() < TargetFrame && Steps < MaxCatchUpFrames; ++Steps)
+	{
+		SubmitLocalInputs(Simulation.GetFrame() + InputDelayFrames);
+		Simulation.AdvanceFrame();
+	}
+}
+
+void AKartRollbackManager::SubmitLocalInputs(int32 InputFrame)
+{
+	for (int32 KartIndex = 0; KartIndex < Session.Karts.Num(); ++KartIndex)
+	{
+		AGoKart* Kart = Session.Karts[KartIndex];
+		if (!Kart || !Kart->IsLocallyControlled())
+		{
+			continue;
+		}
+
+		UGoKartMovementComponent* Movement = Kart->GetKartMovement();
+		Simulation.SetInput(KartIndex, InputFrame, FKartRollbackInput::Quantize(Movement->GetThrottle(), Movement->GetSteeringThrow()));
+
+		// Resend the last few inputs with every new one, unreliable packets can't be waited for
+		int32 FirstFrame = InputFrame;
+		FKartRollbackInput Input;
+		while (FirstFrame > InputFrame - RedundantInputFrames + 1 && Simulation.GetConfirmedInput(KartIndex, FirstFrame - 1, Input))
+		{
+			--FirstFrame;
+		}
+
+		TArray<uint8> PackedInputs;
+		for (int32 PackFrame = FirstFrame; PackFrame <= InputFrame; ++PackFrame)
+		{
+			Simulation.GetConfirmedInput(KartIndex, PackFrame, Input);
+			PackedInputs.Add((uint8)Input.Throttle);
+			PackedInputs.Add((uint8)Input.SteeringThrow);
+		}
+
+		if (HasAuthority())
+		{
+			// Unreliable multicasts wait for the next net update, far longer than we can roll back
+			ForceNetUpdate();
+			Multicast_Inputs(KartIndex, InputFrame, PackedInputs);
+		}
+		else
+		{
+			Kart->Server_SendRollbackInputs(InputFrame, PackedInputs);
+		}
+	}
+}
+
+void AKartRollbackManager::RelayInputs(AGoKart* Kart, int32 LastFrame, const TArray<uint8>& PackedInputs)
+{
+	// A client can only ever speak for its own kart
+	int32 KartIndex = Session.Karts.Find(Kart);
+	if (KartIndex != INDEX_NONE)
+	{
+		ForceNetUpdate();
+		Multicast_Inputs(KartIndex, LastFrame, PackedInputs);
+	}
+}
+
+void AKartRollbackManager::Multicast_Inputs_Implementation(int32 Kart, int32 LastFrame, const TArray<uint8>& PackedInputs)
+{
+	int32 NumInputs = PackedInputs.Num() / 2;
+	for (int32 i = 0; i < NumInputs; ++i)
+	{
+		FKartRollbackInput Input;
+		Input.Throttle = (int8)PackedInputs[2 * i];
+		Input.SteeringThrow = (int8)PackedInputs[2 * i + 1];
+		Simulation.SetInput(Kart, LastFrame - NumInputs + 1 + i, Input);
+	}
+}
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorldAndArgs StartRollbackCommand(
+	TEXT("KrazyKarts.StartRollback"),
+	TEXT("Server only. Switches every kart in play to rollback netcode, if there are few enough of them"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (!World || World->GetNetMode() == NM_Client)
+		{
+			return;
+		}
+
+		AKartRollbackManager* Manager = AKartRollbackManager::Find(World);
+		if (!Manager)
+		{
+			Manager = World->SpawnActor<AKartRollbackManager>();
+		}
+
+		TArray<AGoKart*> Karts;
+		for (TActorIterator<AGoKart> It(World); It; ++It)
+		{
+			if (!It->IsHidden())
+			{
+				Karts.Add(*It);
+			}
+		}
+
+		if (Karts.Num() == 0 || Karts.Num() > Manager->GetMaxKarts())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("StartRollback: rollback supports 1 to %d karts, %d are in play."), Manager->GetMaxKarts(), Karts.Num());
+			return;
+		}
+		Manager->StartSession(Karts);
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs StopRollbackCommand(
+	TEXT("KrazyKarts.StopRollback"),
+	TEXT("Server only. Hands the karts back to server authoritative replication"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (AKartRollbackManager* Manager = AKartRollbackManager::Find(World))
+		{
+			Manager->StopSession();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs BenchRollbackCommand(
+	TEXT("KrazyKarts.BenchRollback"),
+	TEXT("Times re-simulating F frames (default 8) of K karts (default 8) over I rollbacks (default 200), using the karts in the world"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		int32 NumFrames = FMath::Max(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 8, 1);
+		int32 NumKarts = FMath::Max(Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 8, 1);
+		int32 NumRollbacks = FMath::Max(Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 200, 1);
+
+		TArray<UGoKartMovementComponent*> WorldKarts;
+		for (TActorIterator<AGoKart> It(World); It; ++It)
+		{
+			if (!It->IsHidden() && It->GetKartMovement())
+			{
+				WorldKarts.Add(It->GetKartMovement());
+			}
+		}
+		if (WorldKarts.Num() == 0)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("BenchRollback: no karts in the world."));
+			return;
+		}
+
+		// Karts are reused when the world has fewer than asked for, the cost per step is the same
+		TArray<UGoKartMovementComponent*> Karts;
+		for (int32 i = 0; i < NumKarts; ++i)
+		{
+			Karts.Add(WorldKarts[i % WorldKarts.Num()]);
+		}
+
+		TArray<FGoKartSimState> SavedStates;
+		for (UGoKartMovementComponent* Kart : WorldKarts)
+		{
+			SavedStates.Add(Kart->SaveSimState());
+		}
+
+		const float FrameTime = 1 / 60.0f;
+		FKartRollbackSimulation Simulation;
+		Simulation.Init(Karts, FrameTime, NumFrames);
+
+		FRandomStream Random(NumKarts);
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			for (int32 Kart = 0; Kart < NumKarts; ++Kart)
+			{
+				Simulation.SetInput(Kart, Frame, FKartRollbackInput::Quantize(Random.FRandRange(0, 1), Random.FRandRange(-1, 1)));
+			}
+			Simulation.AdvanceFrame();
+		}
+
+		double Start = FPlatformTime::Seconds();
+		for (int32 i = 0; i < NumRollbacks; ++i)
+		{
+			Simulation.ForceRollback(Simulation.GetFrame() - NumFrames);
+			Simulation.Rollback();
+		}
+		double Milliseconds = (FPlatformTime::Seconds() - Start) * 1000 / NumRollbacks;
+
+		for (int32 i = 0; i < WorldKarts.Num(); ++i)
+		{
+			WorldKarts[i]->RestoreSimState(SavedStates[i]);
+		}
+
+		UE_LOG(LogTemp, Log, TEXT("BenchRollback: %d frames x %d karts in %.3fms per rollback (%.2fus per kart step), %.1f%% of a %.1fms frame."),
+			NumFrames, NumKarts, Milliseconds, Milliseconds * 1000 / (NumFrames * NumKarts), Milliseconds / (FrameTime * 10), FrameTime * 1000);
+	}));
+#endif
@@ -0,0 +1,113 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "KartRollbackSimulation.h"
+#include "KartRollbackManager.generated.h"
+
+class AGoKart;
+class UGoKartMovementReplicator;
+
+USTRUCT()
+struct FKartRollbackSession
+{
+	GENERATED_BODY()
+
+	// Karts simulated in lockstep, in the order every machine steps them
+	UPROPERTY()
+	TArray<AGoKart*> Karts;
+
+	// Where each kart starts, at rest
+	UPROPERTY()
+	TArray<FTransform> StartTransforms;
+
+	// Server time of the first frame (s)
+	UPROPERTY()
+	float StartTime = 0;
+};
+
+// Rollback mode for small lobbies: every machine simulates every kart from exchanged inputs instead of
+// following the server's replicated state, and re-simulates when a prediction of a remote input was wrong
+UCLASS()
+class KRAZYKARTS_API AKartRollbackManager : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	AKartRollbackManager();
+
+	virtual void Tick(float DeltaTime) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// Returns the first rollback manager in the world, if any
+	static AKartRollbackManager* Find(UWorld* World);
+
+	// Server only. Moves these karts from server authority to rollback on every machine, StartDelay lets clients catch up (s)
+	void StartSession(const TArray<AGoKart*>& Karts, float StartDelay = 0.5f);
+
+	// Server only. Hands the karts back to the movement replicators
+	void StopSession();
+
+	// Server only. Forwards inputs a client sent for its own kart to every machine
+	void RelayInputs(AGoKart* Kart, int32 LastFrame, const TArray<uint8>& PackedInputs);
+
+	// Server only. Starts the session again from where the karts are now, with a longer delay, for a client in it
+	// that received the session after its first frame. Requests for an earlier session are ignored
+	void RestartSession(AGoKart* Kart, float SessionStartTime);
+
+	const FKartRollbackSimulation& GetSimulation() const { return Simulation; }
+
+	int32 GetMaxKarts() const { return MaxKarts; }
+
+private:
+	UFUNCTION(NetMulticast, Unreliable)
+	void Multicast_Inputs(int32 Kart, int32 LastFrame, const TArray<uint8>& PackedInputs);
+
+	UFUNCTION()
+	void OnRep_Session();
+
+	void BeginSession();
+	void EndSession();
+	void SubmitLocalInputs(int32 InputFrame);
+	float GetServerTime() const;
+
+	UPROPERTY(ReplicatedUsing = OnRep_Session)
+	FKartRollbackSession Session;
+
+	// Length of a simulation frame (s)
+	UPROPERTY(EditAnywhere)
+	float FrameTime = 1 / 60.0f;
+
+	// Furthest back a late input can still be applied, inputs older than this desynchronize the karts (frames)
+	UPROPERTY(EditAnywhere)
+	int32 MaxRollbackFrames = 8;
+
+	// Local inputs are applied this far in the future, so remote machines usually have them in time (frames)
+	UPROPERTY(EditAnywhere)
+	int32 InputDelayFrames = 2;
+
+	// Inputs repeated in every packet, so a few lost packets don't cost a rollback (frames)
+	UPROPERTY(EditAnywhere)
+	int32 RedundantInputFrames = 4;
+
+	// Most frames simulated in one tick when catching up after a hitch (frames)
+	UPROPERTY(EditAnywhere)
+	int32 MaxCatchUpFrames = 8;
+
+	// Rollback re-simulates every kart, so it is only offered to small lobbies
+	UPROPERTY(EditAnywhere)
+	int32 MaxKarts = 8;
+
+	// Longest start delay restarts grow to for clients that keep receiving the session late (s)
+	UPROPERTY(EditAnywhere)
+	float MaxStartDelay = 4;
+
+	float LastStartDelay = 0;
+
+	FKartRollbackSimulation Simulation;
+
+	UPROPERTY()
+	UGoKartMovementReplicator* LocalReplicator;
+};
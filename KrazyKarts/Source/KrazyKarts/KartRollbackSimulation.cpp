@@ -0,0 +1,184 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "KartRollbackSimulation.h"
+
+#include "KrazyKarts.h"
+
+DECLARE_CYCLE_STAT(TEXT("Rollback Resimulate"), STAT_KrazyKartsRollbackResimulate, STATGROUP_KrazyKarts);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Rollback Frames Resimulated"), STAT_KrazyKartsRollbackFrames, STATGROUP_KrazyKarts);
+
+void FKartRollbackSimulation::Init(const TArray<UGoKartMovementComponent*>& InKarts, float InFrameTime, int32 InMaxRollbackFrames, int32 StartFrame)
+{
+	Karts = InKarts;
+	FrameTime = InFrameTime;
+	MaxRollbackFrames = FMath::Max(InMaxRollbackFrames, 1);
+
+	// Room for the frames that can still be rolled back to and as many frames of early inputs
+	BufferFrames = 2 * MaxRollbackFrames + 2;
+
+	States.SetNum(BufferFrames * Karts.Num());
+	Inputs.Reset();
+	Inputs.SetNum(BufferFrames * Karts.Num());
+	LastConfirmedInputs.Init(FKartRollbackInput(), Karts.Num());
+	LastConfirmedFrames.Init(INDEX_NONE, Karts.Num());
+
+	Frame = StartFrame;
+	RollbackFrame = INDEX_NONE;
+	LateInputs = 0;
+}
+
+void FKartRollbackSimulation::Reset()
+{
+	Karts.Reset();
+	States.Reset();
+	Inputs.Reset();
+	LastConfirmedInputs.Reset();
+	LastConfirmedFrames.Reset();
+	RollbackFrame = INDEX_NONE;
+}
+
+void FKartRollbackSimulation::SetInput(int32 Kart, int32 InputFrame, FKartRollbackInput Input)
+{
+	if (!Karts.IsValidIndex(Kart) || InputFrame < 0)
+	{
+		return;
+	}
+
+	if (InputFrame < Frame - MaxRollbackFrames)
+	{
+		++LateInputs;
+		return;
+	}
+
+	// Too far ahead, the slot still holds a frame that may be rolled back to
+	if (InputFrame >= Frame + BufferFrames - MaxRollbackFrames)
+	{
+		return;
+	}
+
+	FInputSlot& Slot = Inputs[GetSlot(InputFrame, Kart)];
+	if (Slot.Frame == InputFrame && Slot.bConfirmed)
+	{
+		return;
+	}
+
+	if (InputFrame < Frame && Slot.Frame == InputFrame && Slot.Input != Input)
+	{
+		RollbackFrame = RollbackFrame == INDEX_NONE ? InputFrame : FMath::Min(RollbackFrame, InputFrame);
+	}
+
+	Slot.Frame = InputFrame;
+	Slot.Input = Input;
+	Slot.bConfirmed = true;
+
+	if (InputFrame > LastConfirmedFrames[Kart])
+	{
+		LastConfirmedFrames[Kart] = InputFrame;
+		LastConfirmedInputs[Kart] = Input;
+	}
+}
+
+bool FKartRollbackSimulation::GetConfirmedInput(int32 Kart, int32 InputFrame, FKartRollbackInput& OutInput) const
+{
+	if (!Karts.IsValidIndex(Kart) || InputFrame < 0)
+	{
+		return false;
+	}
+
+	const FInputSlot& Slot = Inputs[GetSlot(InputFrame, Kart)];
+	if (Slot.Frame != InputFrame || !Slot.bConfirmed)
+	{
+		return false;
+	}
+
+	OutInput = Slot.Input;
+	return true;
+}
+
+FKartRollbackInput FKartRollbackSimulation::GetInputForSimulation(int32 Kart, int32 InputFrame)
+{
+	FInputSlot& Slot = Inputs[GetSlot(InputFrame, Kart)];
+	if (Slot.Frame == InputFrame && Slot.bConfirmed)
+	{
+		return Slot.Input;
+	}
+
+	// Karts mostly hold their inputs, so repeating the last one known is the best guess
+	Slot.Frame = InputFrame;
+	Slot.Input = LastConfirmedInputs[Kart];
+	Slot.bConfirmed = false;
+	return Slot.Input;
+}
+
+void FKartRollbackSimulation::AdvanceFrame()
+{
+	SaveStates(Frame);
+	SimulateFrame(Frame);
+	++Frame;
+}
+
+int32 FKartRollbackSimulation::Rollback()
+{
+	if (RollbackFrame == INDEX_NONE)
+	{
+		return 0;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_KrazyKartsRollbackResimulate);
+
+	int32 FromFrame = FMath::Max(RollbackFrame, Frame - MaxRollbackFrames);
+	RollbackFrame = INDEX_NONE;
+
+	RestoreStates(FromFrame);
+	for (int32 SimFrame = FromFrame; SimFrame < Frame; ++SimFrame)
+	{
+		if (SimFrame > FromFrame)
+		{
+			SaveStates(SimFrame);
+		}
+		SimulateFrame(SimFrame);
+	}
+
+	int32 NumFrames = Frame - FromFrame;
+	INC_DWORD_STAT_BY(STAT_KrazyKartsRollbackFrames, NumFrames);
+	return NumFrames;
+}
+
+void FKartRollbackSimulation::ForceRollback(int32 ToFrame)
+{
+	RollbackFrame = RollbackFrame == INDEX_NONE ? ToFrame : FMath::Min(RollbackFrame, ToFrame);
+}
+
+void FKartRollbackSimulation::SimulateFrame(int32 SimFrame)
+{
+	FGoKartMove Move;
+	Move.DeltaTime = FrameTime;
+	Move.StartTime = SimFrame * FrameTime;
+
+	for (int32 Kart = 0; Kart < Karts.Num(); ++Kart)
+	{
+		FKartRollbackInput Input = GetInputForSimulation(Kart, SimFrame);
+		Move.Throttle = Input.Throttle / 127.0f;
+		Move.SteeringThrow = Input.SteeringThrow / 127.0f;
+		Karts[Kart]->SimulateMove(Move);
+	}
+}
+
+void FKartRollbackSimulation::SaveStates(int32 StateFrame)
+{
+	FGoKartSimState* FrameStates = &States[GetSlot(StateFrame, 0)];
+	for (int32 Kart = 0; Kart < Karts.Num(); ++Kart)
+	{
+		FrameStates[Kart] = Karts[Kart]->SaveSimState();
+	}
+}
+
+void FKartRollbackSimulation::RestoreStates(int32 StateFrame)
+{
+	const FGoKartSimState* FrameStates = &States[GetSlot(StateFrame, 0)];
+	for (int32 Kart = 0; Kart < Karts.Num(); ++Kart)
+	{
+		Karts[Kart]->RestoreSimState(FrameStates[Kart]);
+	}
+}
@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GoKartMovementComponent.h"
+
+// Throttle and steering of one kart for one frame, quantized to a byte each
+struct FKartRollbackInput
+{
+	int8 Throttle = 0;
+	int8 SteeringThrow = 0;
+
+	static FKartRollbackInput Quantize(float Throttle, float SteeringThrow)
+	{
+		FKartRollbackInput Input;
+		Input.Throttle = (int8)FMath::RoundToInt(FMath::Clamp(Throttle, -1.0f, 1.0f) * 127);
+		Input.SteeringThrow = (int8)FMath::RoundToInt(FMath::Clamp(SteeringThrow, -1.0f, 1.0f) * 127);
+		return Input;
+	}
+
+	bool operator==(const FKartRollbackInput& Other) const
+	{
+		return Throttle == Other.Throttle && SteeringThrow == Other.SteeringThrow;
+	}
+
+	bool operator!=(const FKartRollbackInput& Other) const { return !(*this == Other); }
+};
+
+// Steps a fixed set of karts in lockstep frames, predicting inputs that have not arrived yet
+// and re-simulating from the first mispredicted frame when they do
+class KRAZYKARTS_API FKartRollbackSimulation
+{
+public:
+	void Init(const TArray<UGoKartMovementComponent*>& InKarts, float InFrameTime, int32 InMaxRollbackFrames, int32 StartFrame = 0);
+	void Reset();
+
+	bool IsActive() const { return Karts.Num() > 0; }
+	int32 GetFrame() const { return Frame; }
+	int32 GetNumKarts() const { return Karts.Num(); }
+	float GetFrameTime() const { return FrameTime; }
+
+	// Confirms a kart's input for a frame, frames already simulated with a different prediction are rolled back
+	void SetInput(int32 Kart, int32 InputFrame, FKartRollbackInput Input);
+
+	// Confirmed input of a kart, false if it has not arrived or has left the buffer
+	bool GetConfirmedInput(int32 Kart, int32 InputFrame, FKartRollbackInput& OutInput) const;
+
+	// Saves the state of every kart and simulates the current frame
+	void AdvanceFrame();
+
+	// Restores the state at the first mispredicted frame and re-simulates up to the current one, returns the frames re-simulated
+	int32 Rollback();
+
+	// Re-simulates from RollbackFrame on the next Rollback even if every prediction was right
+	void ForceRollback(int32 RollbackFrame);
+
+	// Inputs that arrived after their frame had left the buffer, the karts will have diverged
+	uint32 GetLateInputs() const { return LateInputs; }
+
+private:
+	struct FInputSlot
+	{
+		int32 Frame = INDEX_NONE;
+		FKartRollbackInput Input;
+		bool bConfirmed = false;
+	};
+
+	int32 GetSlot(int32 SlotFrame, int32 Kart) const { return (SlotFrame % BufferFrames) * Karts.Num() + Kart; }
+
+	FKartRollbackInput GetInputForSimulation(int32 Kart, int32 InputFrame);
+	void SimulateFrame(int32 SimFrame);
+	void SaveStates(int32 StateFrame);
+	void RestoreStates(int32 StateFrame);
+
+	TArray<UGoKartMovementComponent*> Karts;
+
+	// Kart states at the start of each buffered frame and the inputs for each buffered frame, indexed by GetSlot
+	TArray<FGoKartSimState> States;
+	TArray<FInputSlot> Inputs;
+
+	// Latest confirmed input of each kart, used as the prediction for frames it hasn't sent yet
+	TArray<FKartRollbackInput> LastConfirmedInputs;
+	TArray<int32> LastConfirmedFrames;
+
+	float FrameTime = 1 / 60.0f;
+	int32 MaxRollbackFrames = 8;
+	int32 BufferFrames = 0;
+
+	int32 Frame = 0;
+	int32 RollbackFrame = INDEX_NONE;
+	uint32 LateInputs = 0;
+};
@@ -0,0 +1,437 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "KartSnapshotBroadcaster.h"
+
+#include "Components/PrimitiveComponent.h"
+#include "Engine/NetSerialization.h"
+#include "GameFramework/MovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "Net/UnrealNetwork.h"
+#include "Serialization/BitReader.h"
+#include "Serialization/BitWriter.h"
+
+#include "GoKartMovementComponent.h"
+#include "GoKartMovementReplicator.h"
+#include "KartNetTelemetry.h"
+#include "KartRaceSession.h"
+#include "KrazyKarts.h"
+#include "KrazyKartsGameState.h"
+#include "ReplicatedVehicleMovement.h"
+
+DECLARE_CYCLE_STAT(TEXT("Snapshot Encode"), STAT_KrazyKartsSnapshotEncode, STATGROUP_KrazyKarts);
+DECLARE_CYCLE_STAT(TEXT("Snapshot Apply"), STAT_KrazyKartsSnapshotApply, STATGROUP_KrazyKarts);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Snapshot Proxies"), STAT_KrazyKartsSnapshotProxies, STATGROUP_KrazyKarts);
+
+AKartSnapshotBroadcaster::AKartSnapshotBroadcaster()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	bReplicates = true;
+	bAlwaysRelevant = false;
+	NetUpdateFrequency = 2;
+
+	Origin = FVector::ZeroVector;
+	Session = nullptr;
+}
+
+void AKartSnapshotBroadcaster::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+	DOREPLIFETIME(AKartSnapshotBroadcaster, Origin);
+	DOREPLIFETIME(AKartSnapshotBroadcaster, Roster);
+}
+
+void AKartSnapshotBroadcaster::Init(AKartRaceSession* InSession)
+{
+	Session = InSession;
+	Origin = Session ? Session->GetOrigin() : FVector::ZeroVector;
+
+	// Send the standings of this tick rather than the last
+	if (Session)
+	{
+		AddTickPrerequisiteActor(Session);
+	}
+}
+
+bool AKartSnapshotBroadcaster::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	const AKrazyKartsGameState* RaceState = GetWorld()->GetGameState<AKrazyKartsGameState>();
+	return RaceState && Session && RaceState->IsSnapshotViewer(RealViewer) && RaceState->GetSessionId(RealViewer) == Session->GetSessionId();
+}
+
+void AKartSnapshotBroadcaster::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	AKrazyKartsGameState* RaceState = GetWorld()->GetGameState<AKrazyKartsGameState>();
+	if (HasAuthority() && RaceState && Session)
+	{
+		for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+		{
+			if (RaceState->GetSessionId(It->Get()) == Session->GetSessionId())
+			{
+				RaceState->SetSnapshotViewer(It->Get(), false);
+			}
+		}
+	}
+
+	DestroyProxies();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AKartSnapshotBroadcaster::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (!HasAuthority())
+	{
+		InterpolateProxies(DeltaSeconds);
+		return;
+	}
+
+	if (!Session)
+	{
+		return;
+	}
+
+	TimeSinceSnapshot += DeltaSeconds;
+	if (SnapshotRate <= 0 || TimeSinceSnapshot < 1 / SnapshotRate)
+	{
+		return;
+	}
+	TimeSinceSnapshot = FMath::Fmod(TimeSinceSnapshot, 1 / SnapshotRate);
+
+	UpdateViewers();
+	UpdateRoster();
+	BroadcastSnapshot();
+}
+
+void AKartSnapshotBroadcaster::UpdateViewers()
+{
+	AKrazyKartsGameState* RaceState = GetWorld()->GetGameState<AKrazyKartsGameState>();
+	if (!RaceState)
+	{
+		return;
+	}
+
+	// Players keep their place in line, so a join never moves an earlier player onto snapshots
+	int32 NumDirectViewers = 0;
+	NumSnapshotViewers = 0;
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		APlayerController* Viewer = It->Get();
+		if (!Viewer || Viewer->IsLocalController() || RaceState->GetSessionId(Viewer) != Session->GetSessionId())
+		{
+			continue;
+		}
+
+		const bool bSpectator = Viewer->PlayerState && Viewer->PlayerState->IsSpectator();
+		const bool bSnapshotViewer = (bSpectator && bSpectatorsUseSnapshots) || (MaxDirectViewers >= 0 && NumDirectViewers >= MaxDirectViewers);
+		RaceState->SetSnapshotViewer(Viewer, bSnapshotViewer);
+
+		if (bSnapshotViewer)
+		{
+			++NumSnapshotViewers;
+		}
+		else
+		{
+			++NumDirectViewers;
+		}
+	}
+}
+
+void AKartSnapshotBroadcaster::UpdateRoster()
+{
+	const TArray<FKartRaceStanding>& Standings = Session->GetStandings();
+
+	bool bChanged = false;
+	for (const FKartRaceStanding& Standing : Standings)
+	{
+		if (Standing.Kart && !KartIds.Contains(Standing.Kart))
+		{
+			FKartSnapshotRosterEntry& Entry = Roster.AddDefaulted_GetRef();
+			Entry.Id = NextKartId++;
+			Entry.KartClass = Standing.Kart->GetClass();
+			Entry.Kart = Standing.Kart;
+			KartIds.Add(Standing.Kart, Entry.Id);
+			bChanged = true;
+		}
+	}
+
+	if (KartIds.Num() != Standings.Num())
+	{
+		for (auto It = KartIds.CreateIterator(); It; ++It)
+		{
+			AActor* Kart = It.Key().Get();
+			if (!Kart || !Standings.ContainsByPredicate([Kart](const FKartRaceStanding& Standing) { return Standing.Kart == Kart; }))
+			{
+				const uint16 Id = It.Value();
+				Roster.RemoveAllSwap([Id](const FKartSnapshotRosterEntry& Entry) { return Entry.Id == Id; });
+				It.RemoveCurrent();
+				bChanged = true;
+			}
+		}
+	}
+
+	if (bChanged)
+	{
+		ForceNetUpdate();
+	}
+}
+
+void AKartSnapshotBroadcaster::BroadcastSnapshot()
+{
+	// Nobody to send to, so nothing to encode
+	if (NumSnapshotViewers == 0)
+	{
+		return;
+	}
+
+	uint64 StartCycles = FPlatformTime::Cycles64();
+	{
+		SCOPE_CYCLE_COUNTER(STAT_KrazyKartsSnapshotEncode);
+
+		States.Reset();
+		for (const TPair<TWeakObjectPtr<AActor>, uint16>& Pair : KartIds)
+		{
+			AActor* Kart = Pair.Key.Get();
+			if (!Kart)
+			{
+				continue;
+			}
+
+			FKartSnapshotState& State = States.AddDefaulted_GetRef();
+			State.Id = Pair.Value;
+			State.Location = Kart->GetActorLocation() - Origin;
+			State.Rotation = Kart->GetActorRotation();
+
+			TArray<UActorComponent*> Movements = Kart->GetComponentsByInterface(UReplicatedVehicleMovement::StaticClass());
+			IReplicatedVehicleMovement* Movement = Movements.Num() > 0 ? Cast<IReplicatedVehicleMovement>(Movements[0]) : nullptr;
+			State.Velocity = Movement ? Movement->GetVelocity() * 100 : Kart->GetVelocity();
+		}
+
+		AGameStateBase* GameState = GetWorld()->GetGameState();
+		Encode(GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds(), States, Buffer);
+	}
+	FKartNetTelemetry::Get().RecordSnapshotSent(Buffer.Num(), NumSnapshotViewers, FPlatformTime::Cycles64() - StartCycles);
+
+	// Unreliable multicasts wait for the next net update, so send this one now
+	ForceNetUpdate();
+	Multicast_Snapshot(Buffer);
+}
+
+void AKartSnapshotBroadcaster::Encode(float ServerTime, const TArray<FKartSnapshotState>& InStates, TArray<uint8>& OutData)
+{
+	FBitWriter Writer(0, true);
+	Writer << ServerTime;
+
+	uint32 NumStates = InStates.Num();
+	Writer.SerializeIntPacked(NumStates);
+	for (const FKartSnapshotState& State : InStates)
+	{
+		uint32 Id = State.Id;
+		Writer.SerializeIntPacked(Id);
+
+		// Millimetre locations within 8km of the race origin, the same quantization as FVector_NetQuantize10
+		WritePackedVector<10, 24>(State.Location, Writer);
+		WritePackedVector<10, 24>(State.Velocity, Writer);
+
+		FRotator Rotation = State.Rotation;
+		Rotation.SerializeCompressedShort(Writer);
+	}
+
+	OutData = *Writer.GetBuffer();
+}
+
+bool AKartSnapshotBroadcaster::Decode(const TArray<uint8>& Data, float& OutServerTime, TArray<FKartSnapshotState>& OutStates)
+{
+	FBitReader Reader(const_cast<uint8*>(Data.GetData()), Data.Num() * 8);
+	Reader << OutServerTime;
+
+	uint32 NumStates = 0;
+	Reader.SerializeIntPacked(NumStates);
+
+	// Every state takes more than a byte, anything claiming more is corrupt
+	if (Reader.IsError() || NumStates > (uint32)Data.Num())
+	{
+		return false;
+	}
+
+	OutStates.SetNum(NumStates);
+	for (FKartSnapshotState& State : OutStates)
+	{
+		uint32 Id = 0;
+		Reader.SerializeIntPacked(Id);
+		State.Id = (uint16)Id;
+
+		ReadPackedVector<10, 24>(State.Location, Reader);
+		ReadPackedVector<10, 24>(State.Velocity, Reader);
+		State.Rotation.SerializeCompressedShort(Reader);
+	}
+
+	return !Reader.IsError();
+}
+
+void AKartSnapshotBroadcaster::Multicast_Snapshot_Implementation(const TArray<uint8>& Data)
+{
+	if (HasAuthority())
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_KrazyKartsSnapshotApply);
+
+	float ServerTime = 0;
+	if (!Decode(Data, ServerTime, States))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Dropped a corrupt kart snapshot of %d bytes."), Data.Num());
+		return;
+	}
+
+	// Unreliable, so a late snapshot can arrive after a newer one
+	if (LastSnapshotTime >= 0 && ServerTime <= LastSnapshotTime)
+	{
+		return;
+	}
+	const float TimeBetweenUpdates = LastSnapshotTime < 0 ? 1 / FMath::Max(SnapshotRate, 1.0f) : ServerTime - LastSnapshotTime;
+	LastSnapshotTime = ServerTime;
+
+	for (const FKartSnapshotState& State : States)
+	{
+		const FKartSnapshotRosterEntry* Entry = Roster.FindByPredicate([&State](const FKartSnapshotRosterEntry& Candidate) { return Candidate.Id == State.Id; });
+		if (!Entry)
+		{
+			// The roster hasn't caught up with this kart yet
+			continue;
+		}
+
+		// The viewer's own kart still replicates to it, a stand in would sit on top of it
+		if (Entry->Kart)
+		{
+			DestroyProxy(State.Id);
+			continue;
+		}
+
+		const FTransform TargetTransform(State.Rotation, State.Location + Origin);
+
+		FKartSnapshotProxy& Proxy = Proxies.FindOrAdd(State.Id);
+		if (!Proxy.Actor.IsValid())
+		{
+			Proxy.Actor = SpawnStandIn(GetWorld(), Entry->KartClass, TargetTransform);
+			Proxy.Target = State;
+		}
+		if (!Proxy.Actor.IsValid())
+		{
+			continue;
+		}
+
+		Proxy.StartTransform = Proxy.Actor->GetActorTransform();
+		Proxy.StartVelocity = Proxy.Target.Velocity;
+		Proxy.Target = State;
+		Proxy.TimeSinceUpdate = 0;
+		Proxy.TimeBetweenUpdates = TimeBetweenUpdates;
+	}
+}
+
+void AKartSnapshotBroadcaster::InterpolateProxies(float DeltaTime)
+{
+	SET_DWORD_STAT(STAT_KrazyKartsSnapshotProxies, Proxies.Num());
+
+	for (TPair<uint16, FKartSnapshotProxy>& Pair : Proxies)
+	{
+		FKartSnapshotProxy& Proxy = Pair.Value;
+		AActor* Actor = Proxy.Actor.Get();
+		if (!Actor || Proxy.TimeBetweenUpdates < KINDA_SMALL_NUMBER)
+		{
+			continue;
+		}
+
+		Proxy.TimeSinceUpdate += DeltaTime;
+		const float LerpRatio = FMath::Min(Proxy.TimeSinceUpdate / Proxy.TimeBetweenUpdates, 1.0f);
+
+		// Same spline the replicator fits for simulated proxies, velocities are already in cm/s
+		FHermitCubicSpline Spline;
+		Spline.StartLocation = Proxy.StartTransform.GetLocation();
+		Spline.StartDerivative = Proxy.StartVelocity * Proxy.TimeBetweenUpdates;
+		Spline.TargetLocation = Proxy.Target.Location + Origin;
+		Spline.TargetDerivative = Proxy.Target.Velocity * Proxy.TimeBetweenUpdates;
+
+		const FQuat Rotation = FQuat::Slerp(Proxy.StartTransform.GetRotation(), Proxy.Target.Rotation.Quaternion(), LerpRatio);
+		Actor->SetActorLocationAndRotation(Spline.InterpolateLocation(LerpRatio), Rotation);
+	}
+}
+
+void AKartSnapshotBroadcaster::OnRep_Roster()
+{
+	for (auto It = Proxies.CreateIterator(); It; ++It)
+	{
+		const uint16 Id = It.Key();
+		if (!Roster.ContainsByPredicate([Id](const FKartSnapshotRosterEntry& Entry) { return Entry.Id == Id && !Entry.Kart; }))
+		{
+			if (AActor* Actor = It.Value().Actor.Get())
+			{
+				Actor->Destroy();
+			}
+			It.RemoveCurrent();
+		}
+	}
+}
+
+AActor* AKartSnapshotBroadcaster::SpawnStandIn(UWorld* World, TSubclassOf<AActor> KartClass, const FTransform& Transform, bool bEnableCollision)
+{
+	if (!World || !KartClass)
+	{
+		return nullptr;
+	}
+
+	// Deferred so it is already local, and solid or not, by the time its components begin play
+	AActor* Actor = World->SpawnActorDeferred<AActor>(KartClass, Transform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+	if (!Actor)
+	{
+		return nullptr;
+	}
+	Actor->SetFlags(RF_Transient);
+	Actor->SetReplicates(false);
+	Actor->SetActorEnableCollision(bEnableCollision);
+	if (UGoKartMovementComponent* Movement = Actor->FindComponentByClass<UGoKartMovementComponent>())
+	{
+		Movement->SetKartContactsEnabled(bEnableCollision);
+	}
+	Actor->FinishSpawning(Transform);
+
+	// A local stand in only shows the kart, movement comes from the snapshots
+	for (UActorComponent* Component : Actor->GetComponents())
+	{
+		if (Component->Implements<UReplicatedVehicleMovement>() || Component->IsA<UGoKartMovementReplicator>() || Component->IsA<UMovementComponent>())
+		{
+			Component->SetComponentTickEnabled(false);
+		}
+	}
+	if (UPrimitiveComponent* Root = Cast<UPrimitiveComponent>(Actor->GetRootComponent()))
+	{
+		Root->SetSimulatePhysics(false);
+	}
+
+	return Actor;
+}
+
+void AKartSnapshotBroadcaster::DestroyProxy(uint16 Id)
+{
+	FKartSnapshotProxy Proxy;
+	if (Proxies.RemoveAndCopyValue(Id, Proxy) && Proxy.Actor.IsValid())
+	{
+		Proxy.Actor->Destroy();
+	}
+}
+
+void AKartSnapshotBroadcaster::DestroyProxies()
+{
+	for (TPair<uint16, FKartSnapshotProxy>& Pair : Proxies)
+	{
+		if (AActor* Actor = Pair.Value.Actor.Get())
+		{
+			Actor->Destroy();
+		}
+	}
+	Proxies.Empty();
+}
@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "KartSnapshotBroadcaster.generated.h"
+
+class AKartRaceSession;
+
+// State of one kart in a snapshot, quantized by the encoding
+struct FKartSnapshotState
+{
+	uint16 Id = 0;
+
+	// Relative to the race origin (cm)
+	FVector Location = FVector::ZeroVector;
+	FRotator Rotation = FRotator::ZeroRotator;
+
+	// (cm/s)
+	FVector Velocity = FVector::ZeroVector;
+};
+
+// Kart a snapshot id stands for, the class is all a client needs to build a stand in
+USTRUCT()
+struct FKartSnapshotRosterEntry
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+	uint16 Id = 0;
+
+	UPROPERTY()
+	TSubclassOf<AActor> KartClass;
+
+	// Only resolves on machines the kart replicates to directly, such as its driver, which need no stand in
+	UPROPERTY()
+	AActor* Kart = nullptr;
+};
+
+// Stand in for a kart on a snapshot viewer, interpolated between snapshots
+struct FKartSnapshotProxy
+{
+	TWeakObjectPtr<AActor> Actor;
+	FTransform StartTransform;
+	FVector StartVelocity = FVector::ZeroVector;
+	FKartSnapshotState Target;
+	float TimeSinceUpdate = 0;
+	float TimeBetweenUpdates = 0;
+};
+
+// Sends every kart of a race as one shared snapshot to spectators and to players past MaxDirectViewers.
+// The snapshot is encoded once per send and goes out as a multicast, so the cost of serializing karts
+// no longer grows with the number of viewers. Snapshot viewers only replicate the kart they drive.
+UCLASS()
+class KRAZYKARTS_API AKartSnapshotBroadcaster : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	AKartSnapshotBroadcaster();
+
+	virtual void Tick(float DeltaSeconds) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
+
+	/** Server only */
+	void Init(AKartRaceSession* InSession);
+
+	static void Encode(float ServerTime, const TArray<FKartSnapshotState>& InStates, TArray<uint8>& OutData);
+	static bool Decode(const TArray<uint8>& Data, float& OutServerTime, TArray<FKartSnapshotState>& OutStates);
+
+	/** Spawns a local, unreplicated kart that only shows itself, with its movement switched off so the caller can place it.
+	 * Without collision it also stays out of kart contacts */
+	static AActor* SpawnStandIn(UWorld* World, TSubclassOf<AActor> KartClass, const FTransform& Transform, bool bEnableCollision = true);
+
+private:
+	void UpdateViewers();
+	void UpdateRoster();
+	void BroadcastSnapshot();
+
+	UFUNCTION(NetMulticast, Unreliable)
+	void Multicast_Snapshot(const TArray<uint8>& Data);
+
+	UFUNCTION()
+	void OnRep_Roster();
+
+	void DestroyProxies();
+	void DestroyProxy(uint16 Id);
+	void InterpolateProxies(float DeltaTime);
+
+	UPROPERTY(Replicated)
+	FVector Origin;
+
+	UPROPERTY(ReplicatedUsing = OnRep_Roster)
+	TArray<FKartSnapshotRosterEntry> Roster;
+
+	// Snapshots sent per second
+	UPROPERTY(EditAnywhere)
+	float SnapshotRate = 20;
+
+	// Players per race that replicate every kart directly, the rest get snapshots. Negative sends every player snapshots
+	UPROPERTY(EditAnywhere)
+	int32 MaxDirectViewers = 16;
+
+	// Spectators get snapshots regardless of MaxDirectViewers
+	UPROPERTY(EditAnywhere)
+	bool bSpectatorsUseSnapshots = true;
+
+	UPROPERTY()
+	AKartRaceSession* Session;
+
+	// Server
+	TMap<TWeakObjectPtr<AActor>, uint16> KartIds;
+	uint16 NextKartId = 0;
+	int32 NumSnapshotViewers = 0;
+	float TimeSinceSnapshot = 0;
+	TArray<FKartSnapshotState> States;
+	TArray<uint8> Buffer;
+
+	// Snapshot viewers
+	TMap<uint16, FKartSnapshotProxy> Proxies;
+	float LastSnapshotTime = -1;
+};
@@ -0,0 +1,201 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "KartTrack.h"
+
+#include "Components/SplineComponent.h"
+#include "Engine/AssetManager.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+
+#include "KartAssetManifest.h"
+
+// Sets default values
+AKartTrack::AKartTrack()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	Spline = CreateDefaultSubobject<USplineComponent>(TEXT("Spline"));
+	Spline->SetClosedLoop(true);
+	RootComponent = Spline;
+}
+
+// Called when the game starts or when spawned
+void AKartTrack::BeginPlay()
+{
+	Super::BeginPlay();
+
+	BuildCenterline();
+
+	if (!AssetManifest.IsNull())
+	{
+		ManifestHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(AssetManifest.ToSoftObjectPath(),
+			FStreamableDelegate::CreateUObject(this, &AKartTrack::RequestManifestAssets));
+	}
+}
+
+void AKartTrack::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (ManifestHandle.IsValid())
+	{
+		ManifestHandle->CancelHandle();
+		ManifestHandle.Reset();
+	}
+	if (PreloadHandle.IsValid())
+	{
+		PreloadHandle->CancelHandle();
+		PreloadHandle.Reset();
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AKartTrack::RequestManifestAssets()
+{
+	UKartAssetManifest* Manifest = AssetManifest.Get();
+	if (!Manifest)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s: could not load asset manifest %s."), *GetName(), *AssetManifest.ToString());
+		return;
+	}
+
+	TArray<FSoftObjectPath> Assets;
+	Manifest->GetAssetsToLoad(Assets);
+	if (Assets.Num() > 0)
+	{
+		// Karts requesting the same assets share these loads instead of starting their own
+		PreloadHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(Assets, FStreamableDelegate(), FStreamableManager::AsyncLoadHighPriority);
+	}
+}
+
+AKartTrack* AKartTrack::FindTrack(UWorld* World)
+{
+	return World ? FindTrackInLevel(World->PersistentLevel) : nullptr;
+}
+
+AKartTrack* AKartTrack::FindTrackInLevel(ULevel* Level)
+{
+	if (!Level)
+	{
+		return nullptr;
+	}
+
+	for (AActor* Actor : Level->Actors)
+	{
+		if (AKartTrack* Track = Cast<AKartTrack>(Actor))
+		{
+			return Track;
+		}
+	}
+	return nullptr;
+}
+
+void AKartTrack::BuildCenterline()
+{
+	Length = Spline->GetSplineLength();
+	int32 NumSegments = FMath::Max(1, FMath::CeilToInt(Length / SegmentLength));
+	float Step = Length / NumSegments;
+
+	Segments.Reset(NumSegments);
+	FVector Start = Spline->GetLocationAtDistanceAlongSpline(0, ESplineCoordinateSpace::World);
+	for (int32 i = 0; i < NumSegments; ++i)
+	{
+		FVector End = Spline->GetLocationAtDistanceAlongSpline((i + 1) * Step, ESplineCoordinateSpace::World);
+
+		FKartTrackSegment& Segment = Segments.AddDefaulted_GetRef();
+		Segment.Start = Start;
+		Segment.Length = FVector::Dist(Start, End);
+		Segment.Direction = Segment.Length > KINDA_SMALL_NUMBER ? (End - Start) / Segment.Length : FVector::ForwardVector;
+		Segment.StartDistance = i * Step;
+
+		Start = End;
+	}
+
+	Index.Build(Segments, IndexCellSize);
+}
+
+FKartTrackProjection AKartTrack::ProjectPoint(const FVector& Location, int32 HintSegment, int32 Window) const
+{
+	FKartTrackProjection Best;
+	const int32 NumSegments = Segments.Num();
+	if (NumSegments == 0)
+	{
+		return Best;
+	}
+
+	if (HintSegment == INDEX_NONE || 2 * Window + 1 >= NumSegments)
+	{
+		return Index.Query(Segments, Location);
+	}
+
+	const bool bClosedLoop = Spline->IsClosedLoop();
+	for (int32 Offset = -Window; Offset <= Window; ++Offset)
+	{
+		int32 SegmentIndex = HintSegment + Offset;
+		if (bClosedLoop)
+		{
+			SegmentIndex = (SegmentIndex + NumSegments) % NumSegments;
+		}
+		else if (SegmentIndex < 0 || SegmentIndex >= NumSegments)
+		{
+			continue;
+		}
+		Segments[SegmentIndex].Project(Location, SegmentIndex, Best);
+	}
+	return Best;
+}
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorldAndArgs BenchTrackQueriesCommand(
+	TEXT("KrazyKarts.BenchTrackQueries"),
+	TEXT("Times closest point queries on the track for N random points (default 10000), grid index against a full scan"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		AKartTrack* Track = AKartTrack::FindTrack(World);
+		if (!Track || Track->GetSegments().Num() == 0)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("BenchTrackQueries: no track in the world."));
+			return;
+		}
+
+		int32 NumPoints = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 10000;
+		NumPoints = FMath::Max(NumPoints, 1);
+
+		// Points scattered around the track within a few segments of the centerline
+		const TArray<FKartTrackSegment>& Segments = Track->GetSegments();
+		FRandomStream Random(NumPoints);
+		TArray<FVector> Points;
+		Points.Reserve(NumPoints);
+		for (int32 i = 0; i < NumPoints; ++i)
+		{
+			const FKartTrackSegment& Segment = Segments[Random.RandRange(0, Segments.Num() - 1)];
+			Points.Add(Segment.Start + Random.GetUnitVector() * Random.FRandRange(0, 3000));
+		}
+
+		int32 Mismatches = 0;
+		double IndexTime = 0;
+		double ScanTime = 0;
+		for (const FVector& Point : Points)
+		{
+			double Start = FPlatformTime::Seconds();
+			FKartTrackProjection Indexed = Track->ProjectPoint(Point);
+			IndexTime += FPlatformTime::Seconds() - Start;
+
+			Start = FPlatformTime::Seconds();
+			FKartTrackProjection Scanned;
+			for (int32 i = 0; i < Segments.Num(); ++i)
+			{
+				Segments[i].Project(Point, i, Scanned);
+			}
+			ScanTime += FPlatformTime::Seconds() - Start;
+
+			if (!FMath::IsNearlyEqual(Indexed.DistanceSquared, Scanned.DistanceSquared, 1.0f))
+			{
+				++Mismatches;
+			}
+		}
+
+		UE_LOG(LogTemp, Log, TEXT("BenchTrackQueries: %d segments, %d points. Index %.0f queries/s, full scan %.0f queries/s, %d mismatches."),
+			Segments.Num(), NumPoints, NumPoints / FMath::Max(IndexTime, 1e-9), NumPoints / FMath::Max(ScanTime, 1e-9), Mismatches);
+	}));
+#endif
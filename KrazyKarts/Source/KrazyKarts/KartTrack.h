@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "KartTrackIndex.h"
+#include "KartTrack.generated.h"
+
+class UKartAssetManifest;
+class USplineComponent;
+struct FStreamableHandle;
+
+UCLASS()
+class KRAZYKARTS_API AKartTrack : public AActor
+{
+	GENERATED_BODY()
+	
+public:	
+	// Sets default values for this actor's properties
+	AKartTrack();
+
+protected:
+	// Called when the game starts or when spawned
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:
+	USplineComponent* GetSpline() const { return Spline; }
+
+	// Returns the track placed in the persistent level, if any. Race instances streamed in hold their own copies,
+	// which are only found through their level
+	static AKartTrack* FindTrack(UWorld* World);
+	static AKartTrack* FindTrackInLevel(ULevel* Level);
+
+	// Samples the spline into straight segments, done on BeginPlay and whenever the spline is edited at runtime
+	void BuildCenterline();
+
+	// Closest centerline point, searching only segments within Window of HintSegment when a hint is given
+	// and the grid index otherwise
+	FKartTrackProjection ProjectPoint(const FVector& Location, int32 HintSegment = INDEX_NONE, int32 Window = 4) const;
+
+	float GetLength() const { return Length; }
+	int32 GetNumCheckpoints() const { return NumCheckpoints; }
+	const TArray<FKartTrackSegment>& GetSegments() const { return Segments; }
+
+private:
+	// Centerline of the track, in driving direction
+	UPROPERTY(VisibleAnywhere)
+	USplineComponent* Spline;
+
+	// Length of the segments the centerline is sampled into (cm)
+	UPROPERTY(EditAnywhere)
+	float SegmentLength = 500;
+
+	// Size of the grid cells used to find the segments near a point (cm)
+	UPROPERTY(EditAnywhere)
+	float IndexCellSize = 2000;
+
+	// Checkpoints are spread evenly along the track, the first one is the start line
+	UPROPERTY(EditAnywhere)
+	int32 NumCheckpoints = 8;
+
+	// Vehicles and other assets to stream in while the race is set up
+	UPROPERTY(EditAnywhere)
+	TSoftObjectPtr<UKartAssetManifest> AssetManifest;
+
+	// Keeps the manifest's assets resident for as long as the track is in play
+	TSharedPtr<FStreamableHandle> ManifestHandle;
+	TSharedPtr<FStreamableHandle> PreloadHandle;
+
+	void RequestManifestAssets();
+
+	TArray<FKartTrackSegment> Segments;
+
+	FKartTrackIndex Index;
+
+	float Length;
+};
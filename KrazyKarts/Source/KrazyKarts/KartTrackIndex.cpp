@@ -0,0 +1,128 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "KartTrackIndex.h"
+
+void FKartTrackIndex::Build(const TArray<FKartTrackSegment>& Segments, float InCellSize)
+{
+	NumSegments = Segments.Num();
+	CellSize = FMath::Max(InCellSize, 1.0f);
+	CellStarts.Reset();
+	CellSegments.Reset();
+
+	if (Segments.Num() == 0)
+	{
+		NumCellsX = NumCellsY = 0;
+		return;
+	}
+
+	FBox2D Bounds(ForceInit);
+	for (const FKartTrackSegment& Segment : Segments)
+	{
+		FVector End = Segment.Start + Segment.Direction * Segment.Length;
+		Bounds += FVector2D(Segment.Start);
+		Bounds += FVector2D(End);
+	}
+
+	Origin = Bounds.Min;
+	NumCellsX = FMath::Max(1, FMath::CeilToInt((Bounds.Max.X - Bounds.Min.X) / CellSize));
+	NumCellsY = FMath::Max(1, FMath::CeilToInt((Bounds.Max.Y - Bounds.Min.Y) / CellSize));
+
+	// Two passes over the segment bounds: count per cell, then fill, so every cell's list is contiguous
+	TArray<int32> Counts;
+	Counts.SetNumZeroed(NumCellsX * NumCellsY);
+	for (int32 Pass = 0; Pass < 2; ++Pass)
+	{
+		for (int32 Index = 0; Index < Segments.Num(); ++Index)
+		{
+			const FKartTrackSegment& Segment = Segments[Index];
+			FVector End = Segment.Start + Segment.Direction * Segment.Length;
+
+			int32 MinX, MinY, MaxX, MaxY;
+			GetCell(FMath::Min(Segment.Start.X, End.X), FMath::Min(Segment.Start.Y, End.Y), MinX, MinY);
+			GetCell(FMath::Max(Segment.Start.X, End.X), FMath::Max(Segment.Start.Y, End.Y), MaxX, MaxY);
+
+			for (int32 Y = MinY; Y <= MaxY; ++Y)
+			{
+				for (int32 X = MinX; X <= MaxX; ++X)
+				{
+					int32 Cell = Y * NumCellsX + X;
+					if (Pass == 0)
+					{
+						++Counts[Cell];
+					}
+					else
+					{
+						CellSegments[CellStarts[Cell] + --Counts[Cell]] = Index;
+					}
+				}
+			}
+		}
+
+		if (Pass == 0)
+		{
+			CellStarts.SetNumUninitialized(Counts.Num() + 1);
+			CellStarts[0] = 0;
+			for (int32 Cell = 0; Cell < Counts.Num(); ++Cell)
+			{
+				CellStarts[Cell + 1] = CellStarts[Cell] + Counts[Cell];
+			}
+			CellSegments.SetNumUninitialized(CellStarts.Last());
+		}
+	}
+}
+
+FKartTrackProjection FKartTrackIndex::Query(const TArray<FKartTrackSegment>& Segments, const FVector& Location) const
+{
+	FKartTrackProjection Best;
+	if (!ensure(Segments.Num() == NumSegments) || CellStarts.Num() == 0)
+	{
+		return Best;
+	}
+
+	int32 CenterX, CenterY;
+	GetCell(Location.X, Location.Y, CenterX, CenterY);
+
+	// Search square rings of cells outwards. Anything outside ring R is at least R cells away from
+	// the point (or from its clamp onto the grid), so the search can stop once the best hit is closer.
+	const int32 MaxRing = FMath::Max(NumCellsX, NumCellsY);
+	for (int32 Ring = 0; Ring <= MaxRing; ++Ring)
+	{
+		int32 MinX = CenterX - Ring, MaxX = CenterX + Ring;
+		int32 MinY = CenterY - Ring, MaxY = CenterY + Ring;
+
+		for (int32 Y = FMath::Max(MinY, 0); Y <= FMath::Min(MaxY, NumCellsY - 1); ++Y)
+		{
+			bool bEdgeRow = Y == MinY || Y == MaxY;
+			int32 Step = bEdgeRow ? 1 : MaxX - MinX;
+			for (int32 X = MinX; X <= MaxX; X += FMath::Max(Step, 1))
+			{
+				if (X < 0 || X >= NumCellsX)
+				{
+					continue;
+				}
+
+				int32 Cell = Y * NumCellsX + X;
+				for (int32 i = CellStarts[Cell]; i < CellStarts[Cell + 1]; ++i)
+				{
+					int32 Index = CellSegments[i];
+					Segments[Index].Project(Location, Index, Best);
+				}
+			}
+		}
+
+		float Reach = Ring * CellSize;
+		if (Best.Segment != INDEX_NONE && Best.DistanceSquared <= Reach * Reach)
+		{
+			break;
+		}
+	}
+
+	return Best;
+}
+
+void FKartTrackIndex::GetCell(float X, float Y, int32& OutX, int32& OutY) const
+{
+	OutX = FMath::Clamp(FMath::FloorToInt((X - Origin.X) / CellSize), 0, NumCellsX - 1);
+	OutY = FMath::Clamp(FMath::FloorToInt((Y - Origin.Y) / CellSize), 0, NumCellsY - 1);
+}
@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FKartTrackProjection
+{
+	int32 Segment = INDEX_NONE;
+	// Distance along the track of the closest centerline point (cm)
+	float Distance = 0;
+	// Signed distance from the centerline, positive to the right (cm)
+	float LateralOffset = 0;
+	float DistanceSquared = MAX_flt;
+};
+
+// Straight piece of the sampled track centerline
+struct FKartTrackSegment
+{
+	FVector Start;
+	FVector Direction;
+	float Length;
+	// Distance along the track at Start (cm)
+	float StartDistance;
+
+	// Replaces Best if Location is closer to this segment
+	void Project(const FVector& Location, int32 Index, FKartTrackProjection& Best) const
+	{
+		FVector ToLocation = Location - Start;
+		float Along = FMath::Clamp(FVector::DotProduct(ToLocation, Direction), 0.0f, Length);
+		FVector Offset = ToLocation - Direction * Along;
+		float DistanceSquared = Offset.SizeSquared();
+
+		if (DistanceSquared < Best.DistanceSquared)
+		{
+			// Right of the driving direction, as seen from above
+			FVector Right = FVector(-Direction.Y, Direction.X, 0).GetSafeNormal();
+
+			Best.Segment = Index;
+			Best.Distance = StartDistance + Along;
+			Best.LateralOffset = FVector::DotProduct(Offset, Right);
+			Best.DistanceSquared = DistanceSquared;
+		}
+	}
+};
+
+// Uniform grid over the track seen from above. Each cell lists the segments crossing it, stored
+// back to back in one array, so a query only touches the few cells around the point.
+// The index holds segment numbers only: rebuild it whenever the segments change and pass the
+// same array to every query.
+struct KRAZYKARTS_API FKartTrackIndex
+{
+	void Build(const TArray<FKartTrackSegment>& Segments, float InCellSize);
+
+	// Closest centerline point to Location among Segments, exact
+	FKartTrackProjection Query(const TArray<FKartTrackSegment>& Segments, const FVector& Location) const;
+
+private:
+	void GetCell(float X, float Y, int32& OutX, int32& OutY) const;
+
+	// Segments the index was built from, queries against any other count find nothing
+	int32 NumSegments = 0;
+
+	FVector2D Origin;
+	float CellSize = 0;
+	int32 NumCellsX = 0;
+	int32 NumCellsY = 0;
+
+	// Segments of cell i are CellSegments[CellStarts[i]] to CellSegments[CellStarts[i + 1] - 1]
+	TArray<int32> CellStarts;
+	TArray<int32> CellSegments;
+};
@@ -0,0 +1,175 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "KartBench.h"
+
+#if !UE_BUILD_SHIPPING
+
+#include "GameFramework/Controller.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "PhysicsPublic.h"
+
+#include "KrazyKartsPawn.h"
+#include "WheeledVehicleMovementAdapter.h"
+
+// Drives a crowd of vehicles with full simulation, LOD by distance and simplified simulation in turn and times the
+// physics scene. The physics time is the game thread's span from the scene's pre tick to its post tick, so it includes
+// the work done while waiting.
+class FKartVehicleBench : public FKartBench
+{
+public:
+	FKartVehicleBench(UWorld* InWorld, int32 NumVehicles, float RunTime)
+		: FKartBench(InWorld, TEXT("BenchVehicles"), UE_ARRAY_COUNT(PhaseLODs), SettleTime, RunTime)
+	{
+		FTransform Origin;
+		APlayerController* PlayerController = InWorld->GetFirstPlayerController();
+		if (AActor* ViewTarget = PlayerController ? PlayerController->GetViewTarget() : nullptr)
+		{
+			Origin = FTransform(FRotator(0, ViewTarget->GetActorRotation().Yaw, 0), ViewTarget->GetActorLocation());
+		}
+
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+		// Rows of ten ahead of the player, so by distance the far rows are simplified and the near ones are not
+		for (int32 i = 0; i < NumVehicles; ++i)
+		{
+			FVector Offset((i / 10) * RowSpacing + FirstRowDistance, ((i % 10) - 4.5f) * ColumnSpacing, 100);
+			AKrazyKartsPawn* Vehicle = InWorld->SpawnActor<AKrazyKartsPawn>(Origin.TransformPosition(Offset), Origin.Rotator(), SpawnParameters);
+			if (!Vehicle)
+			{
+				continue;
+			}
+
+			// Controlled like a bot, so the vehicle takes inputs but isn't the local player's
+			Vehicle->SpawnDefaultController();
+			if (UWheeledVehicleMovementAdapter* Adapter = Vehicle->FindComponentByClass<UWheeledVehicleMovementAdapter>())
+			{
+				Adapter->SetThrottle(0.5f);
+				Adapter->SetSteeringThrow(i % 2 ? 0.5f : -0.5f);
+			}
+			Vehicles.Add(Vehicle);
+		}
+
+		if (FPhysScene* Scene = InWorld->GetPhysicsScene())
+		{
+			PreTickHandle = Scene->OnPhysScenePreTick.AddRaw(this, &FKartVehicleBench::OnPhysScenePreTick);
+			PostTickHandle = Scene->OnPhysScenePostTick.AddRaw(this, &FKartVehicleBench::OnPhysScenePostTick);
+		}
+	}
+
+	virtual ~FKartVehicleBench()
+	{
+		if (FPhysScene* Scene = GetWorld() ? GetWorld()->GetPhysicsScene() : nullptr)
+		{
+			Scene->OnPhysScenePreTick.Remove(PreTickHandle);
+			Scene->OnPhysScenePostTick.Remove(PostTickHandle);
+		}
+
+		for (TWeakObjectPtr<AKrazyKartsPawn> Vehicle : Vehicles)
+		{
+			if (Vehicle.IsValid())
+			{
+				if (AController* Controller = Vehicle->GetController())
+				{
+					Controller->Destroy();
+				}
+				Vehicle->Destroy();
+			}
+		}
+	}
+
+protected:
+	virtual void BeginPhase(int32 Phase) override
+	{
+		OverrideConsoleVariable(TEXT("KrazyKarts.VehicleSimLOD"), FString::FromInt(PhaseLODs[Phase]));
+	}
+
+	virtual void BeginMeasuring(int32 Phase) override
+	{
+		NumFrames = 0;
+		FrameTime = 0;
+		PhysicsTime = 0;
+		bMeasuring = true;
+	}
+
+	virtual void MeasureFrame(float DeltaTime) override
+	{
+		++NumFrames;
+		FrameTime += DeltaTime;
+	}
+
+	virtual void EndPhase(int32 Phase) override
+	{
+		bMeasuring = false;
+
+		int32 NumSimplified = 0;
+		for (TWeakObjectPtr<AKrazyKartsPawn> Vehicle : Vehicles)
+		{
+			UWheeledVehicleMovementAdapter* Adapter = Vehicle.IsValid() ? Vehicle->FindComponentByClass<UWheeledVehicleMovementAdapter>() : nullptr;
+			NumSimplified += Adapter && Adapter->IsSimplified() ? 1 : 0;
+		}
+
+		UE_LOG(LogTemp, Log, TEXT("BenchVehicles: %d vehicles, %s, %d simplified. Physics %.3fms and frame %.3fms per frame over %d frames."),
+			Vehicles.Num(), PhaseNames[Phase], NumSimplified,
+			PhysicsTime * 1000 / FMath::Max(NumFrames, 1), FrameTime * 1000 / FMath::Max(NumFrames, 1), NumFrames);
+	}
+
+private:
+	void OnPhysScenePreTick(FPhysScene* Scene, float DeltaTime)
+	{
+		PreTickTime = FPlatformTime::Seconds();
+	}
+
+	void OnPhysScenePostTick(FPhysScene* Scene)
+	{
+		if (bMeasuring && PreTickTime > 0)
+		{
+			PhysicsTime += FPlatformTime::Seconds() - PreTickTime;
+		}
+		PreTickTime = 0;
+	}
+
+	// KrazyKarts.VehicleSimLOD of each phase
+	static constexpr int32 PhaseLODs[] = { 0, -1, 1 };
+	static constexpr const TCHAR* PhaseNames[] = { TEXT("full simulation"), TEXT("LOD by distance"), TEXT("simplified") };
+
+	// Spawn layout (cm)
+	static constexpr float FirstRowDistance = 1000;
+	static constexpr float RowSpacing = 1500;
+	static constexpr float ColumnSpacing = 800;
+
+	// Time for meshes to stream in and vehicles to switch model at the start of each phase (s)
+	static constexpr float SettleTime = 2;
+
+	TArray<TWeakObjectPtr<AKrazyKartsPawn>> Vehicles;
+	FDelegateHandle PreTickHandle;
+	FDelegateHandle PostTickHandle;
+
+	bool bMeasuring = false;
+	int32 NumFrames = 0;
+	double FrameTime = 0;
+	double PhysicsTime = 0;
+	double PreTickTime = 0;
+};
+
+constexpr int32 FKartVehicleBench::PhaseLODs[];
+constexpr const TCHAR* FKartVehicleBench::PhaseNames[];
+
+static FAutoConsoleCommandWithWorldAndArgs BenchVehiclesCommand(
+	TEXT("KrazyKarts.BenchVehicles"),
+	TEXT("Server or standalone only. Spawns N vehicles (default 50) ahead of the player and times physics for S seconds (default 10) each with full simulation, LOD by distance and simplified simulation"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (!World || World->GetNetMode() == NM_Client)
+		{
+			return;
+		}
+
+		int32 NumVehicles = FMath::Max(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 50, 1);
+		float RunTime = FMath::Max(Args.Num() > 1 ? FCString::Atof(*Args[1]) : 10.0f, 1.0f);
+		FKartBench::Start(MakeUnique<FKartVehicleBench>(World, NumVehicles, RunTime));
+	}));
+
+#endif
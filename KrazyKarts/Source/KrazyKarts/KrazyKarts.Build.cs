@@ -8,8 +8,21 @@ public class KrazyKarts : ModuleRules
 	{
 		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
 
-		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "PhysXVehicles", "HeadMountedDisplay" });
+		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "PhysXVehicles" });
 
-		PublicDefinitions.Add("HMD_MODULE_INCLUDED=1");
+		// Steps the kart model in fixed point, so every build and platform produces bit-identical moves
+		bool bFixedPointKartSimulation = false;
+		PublicDefinitions.Add("KART_FIXED_POINT_SIMULATION=" + (bFixedPointKartSimulation ? "1" : "0"));
+
+		// Dedicated servers have no headset to drive, keep VR out of the server binary
+		if (Target.Type != TargetType.Server)
+		{
+			PublicDependencyModuleNames.Add("HeadMountedDisplay");
+			PublicDefinitions.Add("HMD_MODULE_INCLUDED=1");
+		}
+		else
+		{
+			PublicDefinitions.Add("HMD_MODULE_INCLUDED=0");
+		}
 	}
 }
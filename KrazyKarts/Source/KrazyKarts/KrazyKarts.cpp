@@ -1,7 +1,21 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "KrazyKarts.h"
+#include "KartNetTelemetry.h"
 #include "Modules/ModuleManager.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, KrazyKarts, "KrazyKarts" );
- 
\ No newline at end of file
+class FKrazyKartsModule : public FDefaultGameModuleImpl
+{
+public:
+	virtual void StartupModule() override
+	{
+		FKartNetTelemetry::Get().Start();
+	}
+
+	virtual void ShutdownModule() override
+	{
+		FKartNetTelemetry::Get().Stop();
+	}
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FKrazyKartsModule, KrazyKarts, "KrazyKarts" );
@@ -2,4 +2,10 @@
 
 #pragma once
 
-#include "CoreMinimal.h"
\ No newline at end of file
+#include "CoreMinimal.h"
+#include "EngineDefines.h"
+
+DECLARE_STATS_GROUP(TEXT("KrazyKarts"), STATGROUP_KrazyKarts, STATCAT_Advanced);
+
+// Debug drawing is compiled out of dedicated servers, which have no viewport to draw into
+#define KRAZYKARTS_DRAW_DEBUG (ENABLE_DRAW_DEBUG && !UE_SERVER)
@@ -3,9 +3,312 @@
 #include "KrazyKartsGameMode.h"
 #include "KrazyKartsPawn.h"
 #include "KrazyKartsHud.h"
+#include "KrazyKartsGameState.h"
+#include "KrazyKartsPlayerState.h"
+#include "GoKart.h"
+#include "GoKartBotController.h"
+#include "KartRaceSession.h"
+#include "KartTrack.h"
+#include "Components/SplineComponent.h"
+#include "Kismet/GameplayStatics.h"
 
 AKrazyKartsGameMode::AKrazyKartsGameMode()
 {
 	DefaultPawnClass = AKrazyKartsPawn::StaticClass();
+#if !UE_SERVER
 	HUDClass = AKrazyKartsHud::StaticClass();
+#endif // !UE_SERVER
+	GameStateClass = AKrazyKartsGameState::StaticClass();
+	PlayerStateClass = AKrazyKartsPlayerState::StaticClass();
+
+	NumBots = 0;
+	BotPawnClass = AGoKart::StaticClass();
+	BotSpacing = 800.f;
+
+	MaxSessions = 1;
+	MaxPlayersPerSession = 8;
+	SessionSpacing = 1000000.f;
+
+	KartPoolSize = 8;
+	PooledAcquireTime = 0;
+	PooledAcquireCount = 0;
+	SpawnedAcquireTime = 0;
+	SpawnedAcquireCount = 0;
+}
+
+void AKrazyKartsGameMode::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+	Super::InitGame(MapName, Options, ErrorMessage);
+
+	NumBots = UGameplayStatics::GetIntOption(Options, TEXT("Bots"), NumBots);
+	MaxSessions = UGameplayStatics::GetIntOption(Options, TEXT("Sessions"), MaxSessions);
+
+	// Players log in before StartPlay, so the pool has to be filled here
+	PrewarmKartPool(DefaultPawnClass, KartPoolSize);
+	PrewarmKartPool(BotPawnClass, NumBots);
+}
+
+void AKrazyKartsGameMode::InitGameState()
+{
+	Super::InitGameState();
+
+	// The first race always exists, players log in before StartPlay
+	CreateSession();
+}
+
+AKartRaceSession* AKrazyKartsGameMode::CreateSession()
+{
+	AKrazyKartsGameState* RaceState = GetGameState<AKrazyKartsGameState>();
+	if (!RaceState)
+	{
+		return nullptr;
+	}
+
+	// The first race drives the persistent level, the others an instance of SessionLevel further along X
+	const int32 SessionId = RaceState->GetNumSessions();
+	AKartRaceSession* Session = RaceState->CreateSession(FVector(SessionId * SessionSpacing, 0, 0), SessionId > 0 ? SessionLevel : TSoftObjectPtr<UWorld>());
+	if (Session)
+	{
+		Session->OnReady.AddUObject(this, &AKrazyKartsGameMode::SpawnBots);
+		UE_LOG(LogTemp, Log, TEXT("Started race %d."), SessionId);
+	}
+	return Session;
+}
+
+AKartRaceSession* AKrazyKartsGameMode::FindOrCreateSession()
+{
+	AKrazyKartsGameState* RaceState = GetGameState<AKrazyKartsGameState>();
+	if (!RaceState)
+	{
+		return nullptr;
+	}
+
+	AKartRaceSession* Emptiest = nullptr;
+	int32 FewestPlayers = MAX_int32;
+	for (int32 SessionId = 0; SessionId < RaceState->GetNumSessions(); ++SessionId)
+	{
+		int32 NumPlayers = RaceState->GetNumPlayers(SessionId);
+		if (NumPlayers < MaxPlayersPerSession)
+		{
+			return RaceState->GetSession(SessionId);
+		}
+		if (NumPlayers < FewestPlayers)
+		{
+			FewestPlayers = NumPlayers;
+			Emptiest = RaceState->GetSession(SessionId);
+		}
+	}
+
+	const bool bCanCreate = RaceState->GetNumSessions() < MaxSessions && !SessionLevel.IsNull();
+	AKartRaceSession* Created = bCanCreate ? CreateSession() : nullptr;
+
+	// Once the server is full, races take players past their seat count
+	return Created ? Created : Emptiest;
+}
+
+void AKrazyKartsGameMode::PrewarmKartPool(UClass* KartClass, int32 Count)
+{
+	if (!KartClass || !KartClass->IsChildOf(AGoKart::StaticClass()))
+	{
+		return;
+	}
+
+	for (int32 i = 0; i < Count; ++i)
+	{
+		AGoKart* Kart = SpawnKart(KartClass, FTransform::Identity);
+		if (Kart)
+		{
+			ReleaseKart(Kart);
+		}
+	}
+}
+
+AGoKart* AKrazyKartsGameMode::SpawnKart(UClass* KartClass, const FTransform& Transform)
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	return GetWorld()->SpawnActor<AGoKart>(KartClass, Transform, SpawnParams);
+}
+
+APawn* AKrazyKartsGameMode::AcquirePawn(UClass* PawnClass, const FTransform& Transform, int32 SessionId)
+{
+	APawn* Pawn = AcquirePooledPawn(PawnClass, Transform);
+
+	AKrazyKartsGameState* RaceState = GetGameState<AKrazyKartsGameState>();
+	if (Pawn && RaceState)
+	{
+		RaceState->RegisterKart(Pawn, SessionId);
+	}
+
+	return Pawn;
+}
+
+APawn* AKrazyKartsGameMode::AcquirePooledPawn(UClass* PawnClass, const FTransform& Transform)
+{
+	if (!PawnClass)
+	{
+		return nullptr;
+	}
+
+	if (!PawnClass->IsChildOf(AGoKart::StaticClass()))
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+		return GetWorld()->SpawnActor<APawn>(PawnClass, Transform, SpawnParams);
+	}
+
+	double StartTime = FPlatformTime::Seconds();
+
+	int32 Index = KartPool.IndexOfByPredicate([PawnClass](const AGoKart* Kart) { return Kart && Kart->GetClass() == PawnClass; });
+	if (Index != INDEX_NONE)
+	{
+		AGoKart* Kart = KartPool[Index];
+		KartPool.RemoveAtSwap(Index);
+		Kart->ActivateFromPool(Transform);
+
+		PooledAcquireTime += FPlatformTime::Seconds() - StartTime;
+		++PooledAcquireCount;
+		return Kart;
+	}
+
+	AGoKart* Kart = SpawnKart(PawnClass, Transform);
+
+	SpawnedAcquireTime += FPlatformTime::Seconds() - StartTime;
+	++SpawnedAcquireCount;
+	return Kart;
+}
+
+void AKrazyKartsGameMode::ReleaseKart(AGoKart* Kart)
+{
+	if (!Kart || KartPool.Contains(Kart))
+	{
+		return;
+	}
+
+	if (AController* Controller = Kart->GetController())
+	{
+		Controller->UnPossess();
+	}
+
+	AKrazyKartsGameState* RaceState = GetGameState<AKrazyKartsGameState>();
+	if (RaceState)
+	{
+		RaceState->UnregisterKart(Kart);
+	}
+
+	Kart->ReturnToPool();
+	KartPool.Add(Kart);
+}
+
+APawn* AKrazyKartsGameMode::SpawnDefaultPawnAtTransform_Implementation(AController* NewPlayer, const FTransform& SpawnTransform)
+{
+	// Players keep their race across respawns
+	AKrazyKartsGameState* RaceState = GetGameState<AKrazyKartsGameState>();
+	AKartRaceSession* Session = JoinSession(NewPlayer);
+
+	const int32 SessionId = Session ? Session->GetSessionId() : 0;
+	FTransform Transform = SpawnTransform;
+	if (Session)
+	{
+		Transform.AddToTranslation(Session->GetOrigin());
+	}
+
+	UClass* PawnClass = GetDefaultPawnClassForController(NewPlayer);
+	if (PawnClass && PawnClass->IsChildOf(AGoKart::StaticClass()))
+	{
+		return AcquirePawn(PawnClass, Transform, SessionId);
+	}
+
+	APawn* Pawn = Super::SpawnDefaultPawnAtTransform_Implementation(NewPlayer, Transform);
+
+	if (Pawn && RaceState)
+	{
+		RaceState->RegisterKart(Pawn, SessionId);
+	}
+
+	return Pawn;
+}
+
+AKartRaceSession* AKrazyKartsGameMode::JoinSession(AController* Player)
+{
+	AKrazyKartsGameState* RaceState = GetGameState<AKrazyKartsGameState>();
+	if (!RaceState)
+	{
+		return nullptr;
+	}
+
+	AKartRaceSession* Session = RaceState->GetSession(RaceState->GetSessionId(Player));
+	if (!Session)
+	{
+		Session = FindOrCreateSession();
+		RaceState->SetSessionId(Player, Session ? Session->GetSessionId() : 0);
+	}
+	return Session;
+}
+
+void AKrazyKartsGameMode::PostLogin(APlayerController* NewPlayer)
+{
+	// Before the player spawns, and for spectators who never do, so they receive their race's karts and snapshots
+	JoinSession(NewPlayer);
+
+	Super::PostLogin(NewPlayer);
+}
+
+void AKrazyKartsGameMode::Logout(AController* Exiting)
+{
+	// Take the kart back before the controller destroys it
+	if (Exiting)
+	{
+		ReleaseKart(Cast<AGoKart>(Exiting->GetPawn()));
+	}
+
+	if (AKrazyKartsGameState* RaceState = GetGameState<AKrazyKartsGameState>())
+	{
+		RaceState->SetSessionId(Exiting, INDEX_NONE);
+	}
+
+	Super::Logout(Exiting);
+}
+
+void AKrazyKartsGameMode::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (PooledAcquireCount > 0 || SpawnedAcquireCount > 0)
+	{
+		UE_LOG(LogTemp, Log, TEXT("Kart acquire cost: pooled %d at %.3fms avg, spawned %d at %.3fms avg."),
+			PooledAcquireCount, PooledAcquireCount > 0 ? PooledAcquireTime * 1000 / PooledAcquireCount : 0.0,
+			SpawnedAcquireCount, SpawnedAcquireCount > 0 ? SpawnedAcquireTime * 1000 / SpawnedAcquireCount : 0.0);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AKrazyKartsGameMode::SpawnBots(AKartRaceSession* Session)
+{
+	AKartTrack* Track = Session ? Session->GetTrack() : nullptr;
+	UClass* PawnClass = BotPawnClass;
+	if (NumBots <= 0 || !Track || !PawnClass)
+	{
+		return;
+	}
+
+	// Line the bots up backwards from the start of the track, two abreast
+	USplineComponent* Spline = Track->GetSpline();
+	const float Length = Spline->GetSplineLength();
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	for (int32 i = 0; i < NumBots; ++i)
+	{
+		float Distance = Length - FMath::Fmod((i / 2) * BotSpacing, Length);
+		FTransform Transform = Spline->GetTransformAtDistanceAlongSpline(Distance, ESplineCoordinateSpace::World, false);
+		Transform.AddToTranslation(Transform.GetRotation().GetRightVector() * ((i % 2) ? 0.25f : -0.25f) * BotSpacing);
+
+		APawn* Kart = AcquirePawn(PawnClass, Transform, Session->GetSessionId());
+		AGoKartBotController* Bot = GetWorld()->SpawnActor<AGoKartBotController>(SpawnParams);
+		if (Kart && Bot)
+		{
+			Bot->Possess(Kart);
+		}
+	}
 }
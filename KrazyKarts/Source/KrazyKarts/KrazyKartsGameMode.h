@@ -3,6 +3,9 @@
 #include "GameFramework/GameModeBase.h"
 #include "KrazyKartsGameMode.generated.h"
 
+class AGoKart;
+class AKartRaceSession;
+
 UCLASS(minimalapi)
 class AKrazyKartsGameMode : public AGameModeBase
 {
@@ -10,6 +13,74 @@ class AKrazyKartsGameMode : public AGameModeBase
 
 public:
 	AKrazyKartsGameMode();
+
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+	virtual void InitGameState() override;
+	virtual void PostLogin(APlayerController* NewPlayer) override;
+	virtual void Logout(AController* Exiting) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual APawn* SpawnDefaultPawnAtTransform_Implementation(AController* NewPlayer, const FTransform& SpawnTransform) override;
+
+	/** Takes a kart of PawnClass from the pool, spawning one if none is free, and enters it in a race. Other pawn classes are always spawned */
+	APawn* AcquirePawn(UClass* PawnClass, const FTransform& Transform, int32 SessionId = 0);
+
+	/** Hands a kart back to the pool for the next join, respawn or race */
+	void ReleaseKart(AGoKart* Kart);
+
+private:
+	void SpawnBots(AKartRaceSession* Session);
+
+	/** Race with a free seat, starting a new one when all are full and the server has room */
+	AKartRaceSession* FindOrCreateSession();
+	AKartRaceSession* CreateSession();
+
+	/** Seats a player in a race unless it already has one, returns the race */
+	AKartRaceSession* JoinSession(AController* Player);
+
+	APawn* AcquirePooledPawn(UClass* PawnClass, const FTransform& Transform);
+	void PrewarmKartPool(UClass* KartClass, int32 Count);
+	AGoKart* SpawnKart(UClass* KartClass, const FTransform& Transform);
+
+	/** Karts spawned up front so joins and restarts don't pay for actor spawning, bots are added on top */
+	UPROPERTY(EditAnywhere, Category = Pool)
+	int32 KartPoolSize;
+
+	UPROPERTY()
+	TArray<AGoKart*> KartPool;
+
+	/** Spawn cost report, in seconds */
+	double PooledAcquireTime;
+	int32 PooledAcquireCount;
+	double SpawnedAcquireTime;
+	int32 SpawnedAcquireCount;
+
+	/** Number of bot karts driving the track, can be overridden with ?Bots=N on the URL */
+	UPROPERTY(EditAnywhere, Category = Bots)
+	int32 NumBots;
+
+	/** Kart class spawned for bots, AGoKartBotController only drives AGoKart and its subclasses */
+	UPROPERTY(EditAnywhere, Category = Bots)
+	TSubclassOf<APawn> BotPawnClass;
+
+	/** Distance between bots on the starting grid */
+	UPROPERTY(EditAnywhere, Category = Bots)
+	float BotSpacing;
+
+	/** Races run side by side by this server, each needs its own instance of SessionLevel past the first. Can be overridden with ?Sessions=N on the URL */
+	UPROPERTY(EditAnywhere, Category = Sessions)
+	int32 MaxSessions;
+
+	/** Players per race before the next race is started, bots excluded */
+	UPROPERTY(EditAnywhere, Category = Sessions)
+	int32 MaxPlayersPerSession;
+
+	/** Level holding the track, instanced for every race past the first which drives the persistent level. Player starts stay in the persistent level */
+	UPROPERTY(EditAnywhere, Category = Sessions)
+	TSoftObjectPtr<UWorld> SessionLevel;
+
+	/** Distance between race origins along X, far enough apart that races never see or touch each other (cm) */
+	UPROPERTY(EditAnywhere, Category = Sessions)
+	float SessionSpacing;
 };
 
 
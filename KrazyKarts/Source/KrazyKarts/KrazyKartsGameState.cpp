@@ -0,0 +1,168 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "KrazyKartsGameState.h"
+#include "Engine/Engine.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "KartRaceSession.h"
+#include "KartTrack.h"
+#include "KrazyKartsPlayerState.h"
+
+AKrazyKartsGameState::AKrazyKartsGameState()
+{
+}
+
+AKartRaceSession* AKrazyKartsGameState::CreateSession(const FVector& Origin, TSoftObjectPtr<UWorld> Level)
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.Owner = this;
+	AKartRaceSession* Session = GetWorld()->SpawnActor<AKartRaceSession>(SpawnParams);
+	if (!Session)
+	{
+		return nullptr;
+	}
+
+	Session->Init(Sessions.Num(), Origin, Level);
+	AddSession(Session);
+	return Session;
+}
+
+AKartRaceSession* AKrazyKartsGameState::GetSession(int32 SessionId) const
+{
+	for (AKartRaceSession* Session : Sessions)
+	{
+		if (Session && Session->GetSessionId() == SessionId)
+		{
+			return Session;
+		}
+	}
+	return nullptr;
+}
+
+void AKrazyKartsGameState::AddSession(AKartRaceSession* Session)
+{
+	Sessions.AddUnique(Session);
+}
+
+void AKrazyKartsGameState::RemoveSession(AKartRaceSession* Session)
+{
+	Sessions.Remove(Session);
+}
+
+int32 AKrazyKartsGameState::GetSessionId(const AActor* Actor) const
+{
+	const int32* SessionId = ActorSessions.Find(Actor);
+	if (SessionId)
+	{
+		return *SessionId;
+	}
+
+	// Viewers are player controllers, or their pawn for spectators
+	const APawn* Pawn = Cast<APawn>(Actor);
+	if (Pawn && Pawn->GetController())
+	{
+		SessionId = ActorSessions.Find(Pawn->GetController());
+	}
+	return SessionId ? *SessionId : INDEX_NONE;
+}
+
+void AKrazyKartsGameState::SetSessionId(const AActor* Actor, int32 SessionId)
+{
+	if (SessionId == INDEX_NONE)
+	{
+		ActorSessions.Remove(Actor);
+		SnapshotViewers.Remove(Actor);
+	}
+	else
+	{
+		ActorSessions.Add(Actor, SessionId);
+	}
+
+	// Clients only learn their own race through their player state
+	const AController* Controller = Cast<AController>(Actor);
+	if (AKrazyKartsPlayerState* PlayerState = Controller ? Controller->GetPlayerState<AKrazyKartsPlayerState>() : nullptr)
+	{
+		PlayerState->SetSessionId(SessionId);
+	}
+}
+
+int32 AKrazyKartsGameState::GetNumPlayers(int32 SessionId) const
+{
+	int32 NumPlayers = 0;
+	for (const TPair<TWeakObjectPtr<const AActor>, int32>& Pair : ActorSessions)
+	{
+		if (Pair.Value == SessionId && Cast<APlayerController>(Pair.Key.Get()))
+		{
+			++NumPlayers;
+		}
+	}
+	return NumPlayers;
+}
+
+bool AKrazyKartsGameState::IsRelevantToViewer(const AActor* Actor, const AActor* RealViewer) const
+{
+	const int32 SessionId = GetSessionId(Actor);
+	if (SessionId == INDEX_NONE)
+	{
+		return true;
+	}
+	if (SessionId != GetSessionId(RealViewer))
+	{
+		return false;
+	}
+
+	// Snapshot viewers still replicate the kart they drive
+	return Actor->GetOwner() == RealViewer || !IsSnapshotViewer(RealViewer);
+}
+
+void AKrazyKartsGameState::SetSnapshotViewer(const AActor* Viewer, bool bSnapshotViewer)
+{
+	if (bSnapshotViewer)
+	{
+		SnapshotViewers.Add(Viewer);
+	}
+	else
+	{
+		SnapshotViewers.Remove(Viewer);
+	}
+}
+
+AKartTrack* AKrazyKartsGameState::GetTrack(const AActor* Kart) const
+{
+	AKartRaceSession* Session = GetSession(FMath::Max(GetSessionId(Kart), 0));
+	return Session ? Session->GetTrack() : AKartTrack::FindTrack(GetWorld());
+}
+
+void AKrazyKartsGameState::RegisterKart(AActor* Kart, int32 SessionId)
+{
+	AKartRaceSession* Session = GetSession(SessionId);
+	if (!Kart || !Session)
+	{
+		return;
+	}
+
+	UnregisterKart(Kart);
+	Session->RegisterKart(Kart);
+	ActorSessions.Add(Kart, SessionId);
+}
+
+void AKrazyKartsGameState::UnregisterKart(AActor* Kart)
+{
+	AKartRaceSession* Session = GetSession(GetSessionId(Kart));
+	if (Session)
+	{
+		Session->UnregisterKart(Kart);
+	}
+	ActorSessions.Remove(Kart);
+}
+
+const TArray<FKartRaceStanding>& AKrazyKartsGameState::GetStandings() const
+{
+	static const TArray<FKartRaceStanding> NoStandings;
+
+	// The race of the player on this machine, on clients and listen servers alike
+	APlayerController* LocalPlayer = GEngine->GetFirstLocalPlayerController(GetWorld());
+	const AKrazyKartsPlayerState* PlayerState = LocalPlayer ? LocalPlayer->GetPlayerState<AKrazyKartsPlayerState>() : nullptr;
+	AKartRaceSession* Session = PlayerState ? GetSession(PlayerState->GetSessionId()) : nullptr;
+	return Session ? Session->GetStandings() : NoStandings;
+}
@@ -0,0 +1,99 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+#pragma once
+#include "GameFramework/GameStateBase.h"
+#include "KrazyKartsGameState.generated.h"
+
+class AKartTrack;
+class AKartRaceSession;
+
+/** One row of the race standings, the array index is the race position */
+USTRUCT(BlueprintType)
+struct FKartRaceStanding
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	AActor* Kart = nullptr;
+
+	/** Completed laps */
+	UPROPERTY(BlueprintReadOnly)
+	uint8 Lap = 0;
+
+	/** Checkpoints passed on the current lap */
+	UPROPERTY(BlueprintReadOnly)
+	uint8 Checkpoint = 0;
+
+	/** Fraction of the current lap, 0 to 65535 */
+	UPROPERTY(BlueprintReadOnly)
+	uint16 LapProgress = 0;
+
+	bool operator==(const FKartRaceStanding& Other) const
+	{
+		return Kart == Other.Kart && Lap == Other.Lap && Checkpoint == Other.Checkpoint && LapProgress == Other.LapProgress;
+	}
+};
+
+/** Server side progress of one kart, never replicated */
+struct FKartRaceProgress
+{
+	TWeakObjectPtr<AActor> Kart;
+	int32 Segment = INDEX_NONE;
+	float LastDistance = 0;
+	/** Distance driven since the start line, negative on the grid (cm) */
+	float Progress = 0;
+	int32 CheckpointsPassed = 0;
+};
+
+UCLASS(minimalapi)
+class AKrazyKartsGameState : public AGameStateBase
+{
+	GENERATED_BODY()
+
+public:
+	AKrazyKartsGameState();
+
+	/** Spawns another race sharing this server, server only */
+	AKartRaceSession* CreateSession(const FVector& Origin, TSoftObjectPtr<UWorld> Level);
+
+	AKartRaceSession* GetSession(int32 SessionId) const;
+	int32 GetNumSessions() const { return Sessions.Num(); }
+
+	/** Race a kart or controller takes part in, INDEX_NONE when it hasn't joined one. Only known on the server */
+	int32 GetSessionId(const AActor* Actor) const;
+
+	/** Moves a player controller into a race, INDEX_NONE removes it, server only */
+	void SetSessionId(const AActor* Actor, int32 SessionId);
+
+	/** Players in a race, bots excluded */
+	int32 GetNumPlayers(int32 SessionId) const;
+
+	/** Viewers that see the other karts of their race through its snapshot broadcast, server only */
+	void SetSnapshotViewer(const AActor* Viewer, bool bSnapshotViewer);
+	bool IsSnapshotViewer(const AActor* Viewer) const { return SnapshotViewers.Contains(Viewer); }
+
+	/** False when the viewer drives in another race than the actor, or sees it through snapshots. Actors outside any race are relevant to all */
+	bool IsRelevantToViewer(const AActor* Actor, const AActor* RealViewer) const;
+
+	/** Track of the race a kart takes part in */
+	AKartTrack* GetTrack(const AActor* Kart) const;
+
+	/** Start tracking a kart's race progress, server only */
+	void RegisterKart(AActor* Kart, int32 SessionId = 0);
+	void UnregisterKart(AActor* Kart);
+
+	/** Standings of the race the local player takes part in, ordered by race position */
+	const TArray<FKartRaceStanding>& GetStandings() const;
+
+	/** Called by sessions as they replicate in, clients only receive the race they take part in */
+	void AddSession(AKartRaceSession* Session);
+	void RemoveSession(AKartRaceSession* Session);
+
+private:
+	UPROPERTY()
+	TArray<AKartRaceSession*> Sessions;
+
+	/** Server side race of every kart and player controller */
+	TMap<TWeakObjectPtr<const AActor>, int32> ActorSessions;
+
+	TSet<TWeakObjectPtr<const AActor>> SnapshotViewers;
+};
@@ -11,6 +11,9 @@
 #include "CanvasItem.h"
 #include "UObject/ConstructorHelpers.h"
 #include "Engine/Engine.h"
+#include "KrazyKarts.h"
+
+DECLARE_CYCLE_STAT(TEXT("Draw HUD"), STAT_KrazyKartsDrawHUD, STATGROUP_KrazyKarts);
 
 #define LOCTEXT_NAMESPACE "VehicleHUD"
 
@@ -20,18 +23,39 @@
 
 AKrazyKartsHud::AKrazyKartsHud()
 {
+#if !UE_SERVER
 	static ConstructorHelpers::FObjectFinder<UFont> Font(TEXT("/Engine/EngineFonts/RobotoDistanceField"));
 	HUDFont = Font.Object;
+#endif // !UE_SERVER
+
+	LayoutCanvasSize = FIntPoint::ZeroValue;
 }
 
-void AKrazyKartsHud::DrawHUD()
+void AKrazyKartsHud::UpdateLayout()
 {
-	Super::DrawHUD();
+	LayoutCanvasSize = FIntPoint(Canvas->SizeX, Canvas->SizeY);
 
 	// Calculate ratio from 720p
 	const float HUDXRatio = Canvas->SizeX / 1280.f;
 	const float HUDYRatio = Canvas->SizeY / 720.f;
 
+	SpeedTextPosition = FVector2D(HUDXRatio * 805.f, HUDYRatio * 455);
+	GearTextPosition = FVector2D(HUDXRatio * 805.f, HUDYRatio * 500.f);
+	TextScale = FVector2D(HUDYRatio * 1.4f, HUDYRatio * 1.4f);
+}
+
+void AKrazyKartsHud::DrawHUD()
+{
+	SCOPE_CYCLE_COUNTER(STAT_KrazyKartsDrawHUD);
+
+	Super::DrawHUD();
+
+#if !UE_SERVER
+	if (LayoutCanvasSize.X != Canvas->SizeX || LayoutCanvasSize.Y != Canvas->SizeY)
+	{
+		UpdateLayout();
+	}
+
 	bool bWantHUD = true;
 #if HMD_MODULE_INCLUDED
 	bWantHUD = !GEngine->IsStereoscopic3D();
@@ -43,19 +67,21 @@ void AKrazyKartsHud::DrawHUD()
 		AKrazyKartsPawn* Vehicle = Cast<AKrazyKartsPawn>(GetOwningPawn());
 		if ((Vehicle != nullptr) && (Vehicle->bInCarCameraActive == false))
 		{
-			FVector2D ScaleVec(HUDYRatio * 1.4f, HUDYRatio * 1.4f);
+			// One item is reused for every line so the draws share font and scale and batch together
+			FCanvasTextItem TextItem(SpeedTextPosition, Vehicle->SpeedDisplayString, HUDFont, FLinearColor::White);
+			TextItem.Scale = TextScale;
 
 			// Speed
-			FCanvasTextItem SpeedTextItem(FVector2D(HUDXRatio * 805.f, HUDYRatio * 455), Vehicle->SpeedDisplayString, HUDFont, FLinearColor::White);
-			SpeedTextItem.Scale = ScaleVec;
-			Canvas->DrawItem(SpeedTextItem);
+			Canvas->DrawItem(TextItem);
 
 			// Gear
-			FCanvasTextItem GearTextItem(FVector2D(HUDXRatio * 805.f, HUDYRatio * 500.f), Vehicle->GearDisplayString, HUDFont, Vehicle->bInReverseGear == false ? Vehicle->GearDisplayColor : Vehicle->GearDisplayReverseColor);
-			GearTextItem.Scale = ScaleVec;
-			Canvas->DrawItem(GearTextItem);
+			TextItem.Position = GearTextPosition;
+			TextItem.Text = Vehicle->GearDisplayString;
+			TextItem.SetColor(Vehicle->bInReverseGear == false ? Vehicle->GearDisplayColor : Vehicle->GearDisplayReverseColor);
+			Canvas->DrawItem(TextItem);
 		}
 	}
+#endif // !UE_SERVER
 }
 
 
@@ -19,4 +19,15 @@ public:
 	// Begin AHUD interface
 	virtual void DrawHUD() override;
 	// End AHUD interface
+
+private:
+	/** Recompute text positions and scale for the current canvas size */
+	void UpdateLayout();
+
+	/** Canvas size the layout was computed for */
+	FIntPoint LayoutCanvasSize;
+
+	FVector2D SpeedTextPosition;
+	FVector2D GearTextPosition;
+	FVector2D TextScale;
 };
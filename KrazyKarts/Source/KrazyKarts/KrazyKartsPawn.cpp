@@ -4,6 +4,7 @@
 #include "KrazyKartsWheelFront.h"
 #include "KrazyKartsWheelRear.h"
 #include "KrazyKartsHud.h"
+#include "KrazyKartsVehicleMovement.h"
 #include "Components/SkeletalMeshComponent.h"
 #include "GameFramework/SpringArmComponent.h"
 #include "Camera/CameraComponent.h"
@@ -11,10 +12,16 @@
 #include "WheeledVehicleMovementComponent4W.h"
 #include "Engine/SkeletalMesh.h"
 #include "Engine/Engine.h"
-#include "UObject/ConstructorHelpers.h"
+#include "Engine/AssetManager.h"
+#include "Animation/AnimInstance.h"
 #include "Components/TextRenderComponent.h"
 #include "Materials/Material.h"
 #include "GameFramework/Controller.h"
+#include "KrazyKarts.h"
+#include "KrazyKartsGameState.h"
+#include "GoKartMovementComponent.h"
+#include "GoKartMovementReplicator.h"
+#include "WheeledVehicleMovementAdapter.h"
 
 #ifndef HMD_MODULE_INCLUDED
 #define HMD_MODULE_INCLUDED 0
@@ -26,19 +33,25 @@
 #include "HeadMountedDisplayFunctionLibrary.h"
 #endif // HMD_MODULE_INCLUDED
 
+DECLARE_CYCLE_STAT(TEXT("Vehicle HUD Update"), STAT_KrazyKartsVehicleHUDUpdate, STATGROUP_KrazyKarts);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Vehicle HUD Reformats"), STAT_KrazyKartsVehicleHUDReformats, STATGROUP_KrazyKarts);
+
+// Speeds below this are kept as preformatted text
+static const int32 MaxCachedSpeed = 400;
+
 const FName AKrazyKartsPawn::LookUpBinding("LookUp");
 const FName AKrazyKartsPawn::LookRightBinding("LookRight");
 
 #define LOCTEXT_NAMESPACE "VehiclePawn"
 
-AKrazyKartsPawn::AKrazyKartsPawn()
+AKrazyKartsPawn::AKrazyKartsPawn(const FObjectInitializer& ObjectInitializer)
+	// Inputs reach the server as kart moves, not through the vehicle's own RPC
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UKrazyKartsVehicleMovement>(AWheeledVehicle::VehicleMovementComponentName))
 {
-	// Car mesh
-	static ConstructorHelpers::FObjectFinder<USkeletalMesh> CarMesh(TEXT("/Game/Vehicle/Sedan/Sedan_SkelMesh.Sedan_SkelMesh"));
-	GetMesh()->SetSkeletalMesh(CarMesh.Object);
-
-	static ConstructorHelpers::FClassFinder<UObject> AnimBPClass(TEXT("/Game/Vehicle/Sedan/Sedan_AnimBP"));
-	GetMesh()->SetAnimInstanceClass(AnimBPClass.Class);
+	// Car mesh, animation and in-car text material are streamed in on BeginPlay
+	VehicleMesh = FSoftObjectPath(TEXT("/Game/Vehicle/Sedan/Sedan_SkelMesh.Sedan_SkelMesh"));
+	VehicleAnimClass = FSoftObjectPath(TEXT("/Game/Vehicle/Sedan/Sedan_AnimBP.Sedan_AnimBP_C"));
+	InCarTextMaterial = FSoftObjectPath(TEXT("/Engine/EngineMaterials/AntiAliasedTextMaterialTranslucent.AntiAliasedTextMaterialTranslucent"));
 	
 	// Simulation
 	UWheeledVehicleMovementComponent4W* Vehicle4W = CastChecked<UWheeledVehicleMovementComponent4W>(GetVehicleMovement());
@@ -61,6 +74,16 @@ AKrazyKartsPawn::AKrazyKartsPawn()
 	Vehicle4W->WheelSetups[3].BoneName = FName("Wheel_Rear_Right");
 	Vehicle4W->WheelSetups[3].AdditionalOffset = FVector(0.f, 12.f, 0.f);
 
+	// Replicate through the kart replicator instead of stock replicated movement
+	MovementAdapter = CreateDefaultSubobject<UWheeledVehicleMovementAdapter>(TEXT("MovementAdapter"));
+	SimplifiedMovement = CreateDefaultSubobject<UGoKartMovementComponent>(TEXT("SimplifiedMovement"));
+	// The adapter steps the simplified model itself
+	SimplifiedMovement->PrimaryComponentTick.bStartWithTickEnabled = false;
+	MovementReplicator = CreateDefaultSubobject<UGoKartMovementReplicator>(TEXT("MovementReplicator"));
+	MovementReplicator->SetIsReplicated(true);
+	// Replays are only dead reckoned for physics vehicles, so small errors are left to the local simulation
+	MovementReplicator->SetMinCorrectionError(50.f);
+
 	// Create a spring arm component
 	SpringArm = CreateDefaultSubobject<USpringArmComponent>(TEXT("SpringArm0"));
 	SpringArm->TargetOffset = FVector(0.f, 0.f, 200.f);
@@ -90,14 +113,8 @@ AKrazyKartsPawn::AKrazyKartsPawn()
 	InternalCamera->FieldOfView = 90.f;
 	InternalCamera->SetupAttachment(InternalCameraBase);
 
-	//Setup TextRenderMaterial
-	static ConstructorHelpers::FObjectFinder<UMaterial> TextMaterial(TEXT("Material'/Engine/EngineMaterials/AntiAliasedTextMaterialTranslucent.AntiAliasedTextMaterialTranslucent'"));
-	
-	UMaterialInterface* Material = TextMaterial.Object;
-
 	// Create text render component for in car speed display
 	InCarSpeed = CreateDefaultSubobject<UTextRenderComponent>(TEXT("IncarSpeed"));
-	InCarSpeed->SetTextMaterial(Material);
 	InCarSpeed->SetRelativeLocation(FVector(70.0f, -75.0f, 99.0f));
 	InCarSpeed->SetRelativeRotation(FRotator(18.0f, 180.0f, 0.0f));
 	InCarSpeed->SetupAttachment(GetMesh());
@@ -105,12 +122,11 @@ AKrazyKartsPawn::AKrazyKartsPawn()
 
 	// Create text render component for in car gear display
 	InCarGear = CreateDefaultSubobject<UTextRenderComponent>(TEXT("IncarGear"));
-	InCarGear->SetTextMaterial(Material);
 	InCarGear->SetRelativeLocation(FVector(66.0f, -9.0f, 95.0f));	
 	InCarGear->SetRelativeRotation(FRotator(25.0f, 180.0f,0.0f));
 	InCarGear->SetRelativeScale3D(FVector(1.0f, 0.4f, 0.4f));
 	InCarGear->SetupAttachment(GetMesh());
-	
+
 	// Colors for the incar gear display. One for normal one for reverse
 	GearDisplayReverseColor = FColor(255, 0, 0, 255);
 	GearDisplayColor = FColor(255, 255, 255, 255);
@@ -120,6 +136,9 @@ AKrazyKartsPawn::AKrazyKartsPawn()
 	GearDisplayColor = FColor(255, 255, 255, 255);
 
 	bInReverseGear = false;
+
+	DisplayedKPH = INDEX_NONE;
+	DisplayedGear = INDEX_NONE;
 }
 
 void AKrazyKartsPawn::SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent)
@@ -144,11 +163,13 @@ void AKrazyKartsPawn::SetupPlayerInputComponent(class UInputComponent* PlayerInp
 void AKrazyKartsPawn::MoveForward(float Val)
 {
 	GetVehicleMovementComponent()->SetThrottleInput(Val);
+	MovementAdapter->SetThrottle(Val);
 }
 
 void AKrazyKartsPawn::MoveRight(float Val)
 {
 	GetVehicleMovementComponent()->SetSteeringInput(Val);
+	MovementAdapter->SetSteeringThrow(Val);
 }
 
 void AKrazyKartsPawn::OnHandbrakePressed()
@@ -184,8 +205,11 @@ void AKrazyKartsPawn::EnableIncarView(const bool bState, const bool bForce)
 			Camera->Activate();
 		}
 		
-		InCarSpeed->SetVisibility(bInCarCameraActive);
-		InCarGear->SetVisibility(bInCarCameraActive);
+		if ((InCarSpeed != nullptr) && (InCarGear != nullptr))
+		{
+			InCarSpeed->SetVisibility(bInCarCameraActive);
+			InCarGear->SetVisibility(bInCarCameraActive);
+		}
 	}
 }
 
@@ -197,11 +221,18 @@ void AKrazyKartsPawn::Tick(float Delta)
 	// Setup the flag to say we are in reverse gear
 	bInReverseGear = GetVehicleMovement()->GetCurrentGear() < 0;
 	
-	// Update the strings used in the hud (incar and onscreen)
-	UpdateHUDStrings();
+	// Only the local player sees the hud, and only changed values need reformatting
+	if (IsLocallyControlled())
+	{
+		SCOPE_CYCLE_COUNTER(STAT_KrazyKartsVehicleHUDUpdate);
 
-	// Set the string in the incar hud
-	SetupInCarHUD();
+		// Update the strings used in the hud (incar and onscreen)
+		if (UpdateHUDStrings())
+		{
+			// Set the string in the incar hud
+			SetupInCarHUD();
+		}
+	}
 
 	bool bHMDActive = false;
 #if HMD_MODULE_INCLUDED
@@ -222,15 +253,134 @@ void AKrazyKartsPawn::Tick(float Delta)
 	}
 }
 
+void AKrazyKartsPawn::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	MovementAdapter->SetSimplifiedMovement(SimplifiedMovement);
+	MovementReplicator->SetMovementComponent(MovementAdapter);
+}
+
+bool AKrazyKartsPawn::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	// Vehicles only replicate to players in the same race
+	const AKrazyKartsGameState* RaceState = GetWorld()->GetGameState<AKrazyKartsGameState>();
+	if (RaceState && !RaceState->IsRelevantToViewer(this, RealViewer))
+	{
+		return false;
+	}
+
+	return Super::IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation);
+}
+
 void AKrazyKartsPawn::BeginPlay()
 {
 	Super::BeginPlay();
 
+	if (HasAuthority())
+	{
+		SetReplicateMovement(false);
+	}
+
 	bool bEnableInCar = false;
 #if HMD_MODULE_INCLUDED
 	bEnableInCar = UHeadMountedDisplayFunctionLibrary::IsHeadMountedDisplayEnabled();
 #endif // HMD_MODULE_INCLUDED
 	EnableIncarView(bEnableInCar,true);
+
+	// In-car text is only ever seen by a local player. Created in every build so the pawn's subobjects match
+	// the cooked archetypes, but never rendered or updated on a dedicated server
+	if (IsRunningDedicatedServer())
+	{
+		InCarSpeed->UnregisterComponent();
+		InCarGear->UnregisterComponent();
+	}
+
+	// Without the mesh there are no wheels or body to drive, so hold the movement until it streams in
+	if (GetMesh()->SkeletalMesh == nullptr)
+	{
+		SetMovementEnabled(false);
+	}
+	RequestVehicleAssets();
+}
+
+void AKrazyKartsPawn::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (VehicleAssetsHandle.IsValid())
+	{
+		VehicleAssetsHandle->CancelHandle();
+		VehicleAssetsHandle.Reset();
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AKrazyKartsPawn::SetVehicleAssets(TSoftObjectPtr<USkeletalMesh> Mesh, TSoftClassPtr<UAnimInstance> AnimClass)
+{
+	VehicleMesh = Mesh;
+	VehicleAnimClass = AnimClass;
+
+	if (HasActorBegunPlay())
+	{
+		RequestVehicleAssets();
+	}
+}
+
+void AKrazyKartsPawn::RequestVehicleAssets()
+{
+	TArray<FSoftObjectPath> Assets;
+	Assets.Add(VehicleMesh.ToSoftObjectPath());
+	if (!IsRunningDedicatedServer())
+	{
+		Assets.Add(VehicleAnimClass.ToSoftObjectPath());
+		Assets.Add(InCarTextMaterial.ToSoftObjectPath());
+	}
+	Assets.RemoveAll([](const FSoftObjectPath& Path) { return Path.IsNull(); });
+
+	// Release the previous vehicle only once the new handle holds its own references
+	TSharedPtr<FStreamableHandle> PreviousHandle = VehicleAssetsHandle;
+	VehicleAssetsHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(Assets,
+		FStreamableDelegate::CreateUObject(this, &AKrazyKartsPawn::OnVehicleAssetsLoaded));
+	if (PreviousHandle.IsValid())
+	{
+		PreviousHandle->ReleaseHandle();
+	}
+}
+
+void AKrazyKartsPawn::OnVehicleAssetsLoaded()
+{
+	if (!IsRunningDedicatedServer())
+	{
+		GetMesh()->SetAnimInstanceClass(VehicleAnimClass.Get());
+
+		UMaterialInterface* TextMaterial = InCarTextMaterial.Get();
+		if ((TextMaterial != nullptr) && (InCarSpeed != nullptr) && (InCarGear != nullptr))
+		{
+			InCarSpeed->SetTextMaterial(TextMaterial);
+			InCarGear->SetTextMaterial(TextMaterial);
+		}
+	}
+
+	USkeletalMesh* Mesh = VehicleMesh.Get();
+	if ((Mesh != nullptr) && (GetMesh()->SkeletalMesh != Mesh))
+	{
+		GetMesh()->SetSkeletalMesh(Mesh);
+
+		// The vehicle could not be created without the wheel bones and bodies of the mesh
+		GetVehicleMovement()->RecreatePhysicsState();
+	}
+
+	if (GetMesh()->SkeletalMesh != nullptr)
+	{
+		SetMovementEnabled(true);
+	}
+}
+
+void AKrazyKartsPawn::SetMovementEnabled(bool bEnabled)
+{
+	GetVehicleMovement()->SetComponentTickEnabled(bEnabled);
+	MovementAdapter->SetComponentTickEnabled(bEnabled);
+	MovementReplicator->SetComponentTickEnabled(bEnabled);
 }
 
 void AKrazyKartsPawn::OnResetVR()
@@ -245,13 +395,24 @@ void AKrazyKartsPawn::OnResetVR()
 #endif // HMD_MODULE_INCLUDED
 }
 
-void AKrazyKartsPawn::UpdateHUDStrings()
+bool AKrazyKartsPawn::UpdateHUDStrings()
 {
 	float KPH = FMath::Abs(GetVehicleMovement()->GetForwardSpeed()) * 0.036f;
 	int32 KPH_int = FMath::FloorToInt(KPH);
+	int32 Gear = GetVehicleMovement()->GetCurrentGear();
 
-	// Using FText because this is display text that should be localizable
-	SpeedDisplayString = FText::Format(LOCTEXT("SpeedFormat", "{0} km/h"), FText::AsNumber(KPH_int));
+	if (KPH_int == DisplayedKPH && Gear == DisplayedGear)
+	{
+		return false;
+	}
+
+	INC_DWORD_STAT(STAT_KrazyKartsVehicleHUDReformats);
+
+	if (KPH_int != DisplayedKPH)
+	{
+		SpeedDisplayString = GetSpeedText(KPH_int);
+		DisplayedKPH = KPH_int;
+	}
 	
 	if (bInReverseGear == true)
 	{
@@ -259,9 +420,48 @@ void AKrazyKartsPawn::UpdateHUDStrings()
 	}
 	else
 	{
-		int32 Gear = GetVehicleMovement()->GetCurrentGear();
-		GearDisplayString = (Gear == 0) ? LOCTEXT("N", "N") : FText::AsNumber(Gear);
-	}	
+		GearDisplayString = (Gear == 0) ? LOCTEXT("N", "N") : GetGearText(Gear);
+	}
+	DisplayedGear = Gear;
+
+	return true;
+}
+
+const FText& AKrazyKartsPawn::GetSpeedText(int32 KPH)
+{
+	// Using FText because this is display text that should be localizable
+	if (KPH >= MaxCachedSpeed)
+	{
+		SpeedDisplayString = FText::Format(LOCTEXT("SpeedFormat", "{0} km/h"), FText::AsNumber(KPH));
+		return SpeedDisplayString;
+	}
+
+	if (SpeedTextCache.Num() <= KPH)
+	{
+		SpeedTextCache.SetNum(KPH + 1);
+	}
+
+	FText& Text = SpeedTextCache[KPH];
+	if (Text.IsEmpty())
+	{
+		Text = FText::Format(LOCTEXT("SpeedFormat", "{0} km/h"), FText::AsNumber(KPH));
+	}
+	return Text;
+}
+
+const FText& AKrazyKartsPawn::GetGearText(int32 Gear)
+{
+	if (GearTextCache.Num() <= Gear)
+	{
+		GearTextCache.SetNum(Gear + 1);
+	}
+
+	FText& Text = GearTextCache[Gear];
+	if (Text.IsEmpty())
+	{
+		Text = FText::AsNumber(Gear);
+	}
+	return Text;
 }
 
 void AKrazyKartsPawn::SetupInCarHUD()
@@ -10,6 +10,13 @@ class UCameraComponent;
 class USpringArmComponent;
 class UTextRenderComponent;
 class UInputComponent;
+class UGoKartMovementComponent;
+class UGoKartMovementReplicator;
+class UWheeledVehicleMovementAdapter;
+class USkeletalMesh;
+class UAnimInstance;
+class UMaterialInterface;
+struct FStreamableHandle;
 
 UCLASS(config=Game)
 class AKrazyKartsPawn : public AWheeledVehicle
@@ -40,9 +47,36 @@ class AKrazyKartsPawn : public AWheeledVehicle
 	UPROPERTY(Category = Display, VisibleDefaultsOnly, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
 	UTextRenderComponent* InCarGear;
 
+	/** Exposes the vehicle movement to the kart replicator */
+	UPROPERTY(Category = Replication, VisibleDefaultsOnly, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
+	UWheeledVehicleMovementAdapter* MovementAdapter;
+
+	/** Kinematic model used instead of the wheel simulation when the vehicle is far from every player */
+	UPROPERTY(Category = Replication, VisibleDefaultsOnly, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
+	UGoKartMovementComponent* SimplifiedMovement;
+
+	/** Client prediction and state replication shared with AGoKart */
+	UPROPERTY(Category = Replication, VisibleDefaultsOnly, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
+	UGoKartMovementReplicator* MovementReplicator;
+
+	/** Vehicle mesh, streamed in on BeginPlay. Servers load it too as the wheels are set up from its physics asset */
+	UPROPERTY(Category = Assets, EditDefaultsOnly)
+	TSoftObjectPtr<USkeletalMesh> VehicleMesh;
+
+	/** Animation blueprint for the vehicle mesh, not loaded on dedicated servers */
+	UPROPERTY(Category = Assets, EditDefaultsOnly)
+	TSoftClassPtr<UAnimInstance> VehicleAnimClass;
+
+	/** Material for the in-car text, not loaded on dedicated servers */
+	UPROPERTY(Category = Assets, EditDefaultsOnly)
+	TSoftObjectPtr<UMaterialInterface> InCarTextMaterial;
+
+	/** Keeps the vehicle assets resident while they are in use */
+	TSharedPtr<FStreamableHandle> VehicleAssetsHandle;
+
 	
 public:
-	AKrazyKartsPawn();
+	AKrazyKartsPawn(const FObjectInitializer& ObjectInitializer);
 
 	/** The current speed as a string eg 10 km/h */
 	UPROPERTY(Category = Display, VisibleDefaultsOnly, BlueprintReadOnly)
@@ -76,8 +110,11 @@ public:
 
 	// Begin Actor interface
 	virtual void Tick(float Delta) override;
+	virtual void PostInitializeComponents() override;
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:
 	// End Actor interface
@@ -100,6 +137,9 @@ public:
 	/** Handle reset VR device */
 	void OnResetVR();
 
+	/** Switch to another vehicle, the current one stays until the new assets have streamed in */
+	void SetVehicleAssets(TSoftObjectPtr<USkeletalMesh> Mesh, TSoftClassPtr<UAnimInstance> AnimClass);
+
 	static const FName LookUpBinding;
 	static const FName LookRightBinding;
 
@@ -112,8 +152,30 @@ private:
 	 */
 	void EnableIncarView( const bool bState, const bool bForce = false );
 
-	/** Update the gear and speed strings */
-	void UpdateHUDStrings();
+	/** Start streaming the vehicle assets this instance needs */
+	void RequestVehicleAssets();
+
+	/** Apply the vehicle assets once they are resident */
+	void OnVehicleAssetsLoaded();
+
+	/** Start or stop driving, sending moves and ticking the vehicle simulation */
+	void SetMovementEnabled(bool bEnabled);
+
+	/** Update the gear and speed strings, returns false if they didn't change */
+	bool UpdateHUDStrings();
+
+	/** Speed text for a whole km/h value, formatted once and then reused */
+	const FText& GetSpeedText(int32 KPH);
+
+	/** Gear text for a forward gear, formatted once and then reused */
+	const FText& GetGearText(int32 Gear);
+
+	/** Speed and gear currently shown, INDEX_NONE until the first update */
+	int32 DisplayedKPH;
+	int32 DisplayedGear;
+
+	TArray<FText> SpeedTextCache;
+	TArray<FText> GearTextCache;
 
 	/* Are we on a 'slippery' surface */
 	bool bIsLowFriction;
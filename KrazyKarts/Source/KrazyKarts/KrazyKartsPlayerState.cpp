@@ -0,0 +1,12 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "KrazyKartsPlayerState.h"
+
+#include "Net/UnrealNetwork.h"
+
+void AKrazyKartsPlayerState::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+	DOREPLIFETIME(AKrazyKartsPlayerState, SessionId);
+}
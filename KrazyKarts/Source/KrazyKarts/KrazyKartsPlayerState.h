@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/PlayerState.h"
+#include "KrazyKartsPlayerState.generated.h"
+
+UCLASS()
+class KRAZYKARTS_API AKrazyKartsPlayerState : public APlayerState
+{
+	GENERATED_BODY()
+
+public:
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/** Race the player takes part in, INDEX_NONE before they are seated in one */
+	int32 GetSessionId() const { return SessionId; }
+
+	/** Server only, through AKrazyKartsGameState::SetSessionId */
+	void SetSessionId(int32 NewSessionId) { SessionId = NewSessionId; }
+
+private:
+	/** Replicated so each client can find its own race among the ones it receives */
+	UPROPERTY(Replicated)
+	int32 SessionId = INDEX_NONE;
+};
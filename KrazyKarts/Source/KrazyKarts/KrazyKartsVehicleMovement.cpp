@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "KrazyKartsVehicleMovement.h"
+
+void UKrazyKartsVehicleMovement::UpdateState(float DeltaTime)
+{
+	// Manual gear changes are only made on the locally controlled copy, leave those to the stock replication
+	if (bReplicateInputs || !bReverseAsBrake)
+	{
+		Super::UpdateState(DeltaTime);
+		return;
+	}
+
+	// Same shifting as the stock locally controlled path: between reverse and first, only when slow enough
+	if (FMath::Abs(GetForwardSpeed()) < WrongDirectionThreshold)
+	{
+		if (RawThrottleInput < -KINDA_SMALL_NUMBER && GetCurrentGear() >= 0 && GetTargetGear() >= 0)
+		{
+			SetTargetGear(-1, true);
+		}
+		else if (RawThrottleInput > KINDA_SMALL_NUMBER && GetCurrentGear() <= 0 && GetTargetGear() <= 0)
+		{
+			SetTargetGear(1, true);
+		}
+	}
+
+	SteeringInput = SteeringInputRate.InterpInputValue(DeltaTime, SteeringInput, CalcSteeringInput());
+	ThrottleInput = ThrottleInputRate.InterpInputValue(DeltaTime, ThrottleInput, CalcThrottleInput());
+	BrakeInput = BrakeInputRate.InterpInputValue(DeltaTime, BrakeInput, CalcBrakeInput());
+	HandbrakeInput = HandbrakeInputRate.InterpInputValue(DeltaTime, HandbrakeInput, CalcHandbrakeInput());
+}
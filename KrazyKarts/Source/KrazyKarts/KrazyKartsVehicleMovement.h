@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WheeledVehicleMovementComponent4W.h"
+#include "KrazyKartsVehicleMovement.generated.h"
+
+// Four wheel vehicle movement that leaves input replication to UGoKartMovementReplicator. The stock component sends
+// its inputs to the server with a reliable RPC every tick, on top of the replicator's moves, and steers remote
+// copies from the inputs it replicates back. Here every copy steers from the raw inputs set on it, which the
+// adapter sets from the moves it simulates.
+UCLASS()
+class KRAZYKARTS_API UKrazyKartsVehicleMovement : public UWheeledVehicleMovementComponent4W
+{
+	GENERATED_BODY()
+
+public:
+	// Send inputs with the stock RPC as well, for vehicles not driven through the kart replicator
+	UPROPERTY(EditAnywhere, Category = Replication)
+	bool bReplicateInputs = false;
+
+protected:
+	virtual void UpdateState(float DeltaTime) override;
+};
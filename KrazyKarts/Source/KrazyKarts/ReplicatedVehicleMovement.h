@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "ReplicatedVehicleMovement.generated.h"
+
+USTRUCT()
+struct FGoKartMove
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+	float Throttle;
+	
+	UPROPERTY()
+	float SteeringThrow;
+	
+	UPROPERTY()
+	float DeltaTime;
+
+	UPROPERTY()
+	float StartTime;
+
+	bool IsValid() const
+	{
+		return FMath::Abs(Throttle) <= 1 && FMath::Abs(SteeringThrow) <= 1;
+	}
+};
+
+// Exact state of the fixed point kart simulation, in Q48.16
+USTRUCT()
+struct FGoKartFixedState
+{
+	GENERATED_USTRUCT_BODY()
+
+	// Location on the ground plane (cm)
+	UPROPERTY()
+	int64 X = 0;
+
+	UPROPERTY()
+	int64 Y = 0;
+
+	// Speed along the heading (m/s)
+	UPROPERTY()
+	int64 Speed = 0;
+
+	// Yaw (rad)
+	UPROPERTY()
+	int64 Heading = 0;
+};
+
+UINTERFACE(MinimalAPI)
+class UReplicatedVehicleMovement : public UInterface
+{
+	GENERATED_BODY()
+};
+
+// Vehicle movement that UGoKartMovementReplicator can predict, upload and reconcile
+class KRAZYKARTS_API IReplicatedVehicleMovement
+{
+	GENERATED_BODY()
+
+public:
+	virtual void SimulateMove(const FGoKartMove& Move) = 0;
+
+	// Re-simulates moves the server hasn't acknowledged yet on top of a server state
+	virtual void ReplayMoves(const TArray<FGoKartMove>& Moves)
+	{
+		for (const FGoKartMove& Move : Moves)
+		{
+			SimulateMove(Move);
+		}
+	}
+
+	// Velocity in m/s
+	virtual FVector GetVelocity() = 0;
+	virtual void SetVelocity(FVector NewVelocity) = 0;
+
+	virtual FGoKartMove GetLastMove() = 0;
+
+	// Exact state for movement simulated in fixed point, so replays start from bit-identical values
+	virtual FGoKartFixedState GetFixedState() { return FGoKartFixedState(); }
+	virtual void SetFixedState(const FGoKartFixedState& State) {}
+};
@@ -0,0 +1,218 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WheeledVehicleMovementAdapter.h"
+
+#include "GameFramework/PlayerController.h"
+#include "GoKartMovementComponent.h"
+#include "GoKartMovementReplicator.h"
+#include "HAL/IConsoleManager.h"
+#include "KrazyKarts.h"
+#include "WheeledVehicleMovementComponent.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Vehicles Full Sim"), STAT_KrazyKartsVehiclesFull, STATGROUP_KrazyKarts);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Vehicles Simplified"), STAT_KrazyKartsVehiclesSimplified, STATGROUP_KrazyKarts);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Vehicle LOD Switches"), STAT_KrazyKartsVehicleLODSwitches, STATGROUP_KrazyKarts);
+
+static TAutoConsoleVariable<int32> CVarVehicleSimLOD(
+	TEXT("KrazyKarts.VehicleSimLOD"),
+	-1,
+	TEXT("Simulation of every vehicle but the local player's. -1: by distance to the players, 0: always full, 1: always simplified"),
+	ECVF_Cheat);
+
+// Sets default values for this component's properties
+UWheeledVehicleMovementAdapter::UWheeledVehicleMovementAdapter()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+}
+
+
+// Called when the game starts
+void UWheeledVehicleMovementAdapter::BeginPlay()
+{
+	Super::BeginPlay();
+
+	VehicleMovement = GetOwner()->FindComponentByClass<UWheeledVehicleMovementComponent>();
+}
+
+
+// Called every frame
+void UWheeledVehicleMovementAdapter::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	TimeSinceLODCheck += DeltaTime;
+	if (TimeSinceLODCheck >= LODCheckInterval)
+	{
+		TimeSinceLODCheck = 0;
+		UpdateSimulationLOD();
+	}
+
+	if (bSimplified)
+	{
+		INC_DWORD_STAT(STAT_KrazyKartsVehiclesSimplified);
+	}
+	else
+	{
+		INC_DWORD_STAT(STAT_KrazyKartsVehiclesFull);
+	}
+
+	// Client or server in control of the pawn, the vehicle itself is stepped by the physics scene
+	if (GetOwnerRole() == ROLE_AutonomousProxy || GetOwner()->GetRemoteRole() == ROLE_SimulatedProxy)
+	{
+		LastMove.DeltaTime = DeltaTime;
+		LastMove.Throttle = Throttle;
+		LastMove.SteeringThrow = SteeringThrow;
+		LastMove.StartTime = UGoKartMovementReplicator::GetMoveTime(GetOwner());
+		SimulateMove(LastMove);
+	}
+}
+
+void UWheeledVehicleMovementAdapter::SimulateMove(const FGoKartMove& Move)
+{
+	if (bSimplified)
+	{
+		SimplifiedMovement->SimulateMove(Move);
+		return;
+	}
+
+	if (!VehicleMovement)
+	{
+		return;
+	}
+
+	VehicleMovement->SetThrottleInput(Move.Throttle);
+	VehicleMovement->SetSteeringInput(Move.SteeringThrow);
+}
+
+void UWheeledVehicleMovementAdapter::ReplayMoves(const TArray<FGoKartMove>& Moves)
+{
+	if (bSimplified)
+	{
+		SimplifiedMovement->ReplayMoves(Moves);
+		return;
+	}
+
+	float ReplayTime = 0;
+	for (const FGoKartMove& Move : Moves)
+	{
+		ReplayTime += Move.DeltaTime;
+	}
+
+	// The physics scene can't be stepped for a single vehicle, so carry the server state forward at its velocity
+	GetOwner()->AddActorWorldOffset(GetVelocity() * 100 * ReplayTime, false, nullptr, ETeleportType::TeleportPhysics);
+
+	if (Moves.Num() > 0)
+	{
+		SimulateMove(Moves.Last());
+	}
+}
+
+FVector UWheeledVehicleMovementAdapter::GetVelocity()
+{
+	if (bSimplified)
+	{
+		return SimplifiedMovement->GetVelocity();
+	}
+
+	UPrimitiveComponent* Primitive = GetUpdatedPrimitive();
+	return Primitive ? Primitive->GetPhysicsLinearVelocity() / 100 : FVector::ZeroVector;
+}
+
+void UWheeledVehicleMovementAdapter::SetVelocity(FVector NewVelocity)
+{
+	if (bSimplified)
+	{
+		SimplifiedMovement->SetVelocity(NewVelocity);
+		return;
+	}
+
+	UPrimitiveComponent* Primitive = GetUpdatedPrimitive();
+	if (Primitive)
+	{
+		Primitive->SetPhysicsLinearVelocity(NewVelocity * 100);
+	}
+}
+
+UPrimitiveComponent* UWheeledVehicleMovementAdapter::GetUpdatedPrimitive() const
+{
+	return Cast<UPrimitiveComponent>(GetOwner()->GetRootComponent());
+}
+
+void UWheeledVehicleMovementAdapter::UpdateSimulationLOD()
+{
+	if (!SimplifiedMovement || !VehicleMovement)
+	{
+		return;
+	}
+
+	// The player's own vehicle always gets the full simulation
+	APawn* Pawn = Cast<APawn>(GetOwner());
+	if (Pawn && Pawn->IsLocallyControlled() && Pawn->IsPlayerControlled())
+	{
+		SetSimplified(false);
+		return;
+	}
+
+	int32 ForcedLOD = CVarVehicleSimLOD.GetValueOnGameThread();
+	if (ForcedLOD >= 0)
+	{
+		SetSimplified(ForcedLOD > 0);
+		return;
+	}
+
+	float Distance = GetDistanceToNearestViewer();
+	if (Distance > SimplifiedDistance + SimplifiedDistanceHysteresis / 2)
+	{
+		SetSimplified(true);
+	}
+	else if (Distance < SimplifiedDistance - SimplifiedDistanceHysteresis / 2)
+	{
+		SetSimplified(false);
+	}
+}
+
+float UWheeledVehicleMovementAdapter::GetDistanceToNearestViewer() const
+{
+	// Servers see every player controller, clients only their local ones
+	FVector Location = GetOwner()->GetActorLocation();
+	float MinDistanceSquared = MAX_flt;
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		APlayerController* PlayerController = It->Get();
+		AActor* ViewTarget = PlayerController ? PlayerController->GetViewTarget() : nullptr;
+		if (ViewTarget)
+		{
+			MinDistanceSquared = FMath::Min(MinDistanceSquared, FVector::DistSquared(Location, ViewTarget->GetActorLocation()));
+		}
+	}
+	return FMath::Sqrt(MinDistanceSquared);
+}
+
+void UWheeledVehicleMovementAdapter::SetSimplified(bool bNewSimplified)
+{
+	UPrimitiveComponent* Primitive = GetUpdatedPrimitive();
+	if (bNewSimplified == bSimplified || !Primitive)
+	{
+		return;
+	}
+
+	INC_DWORD_STAT(STAT_KrazyKartsVehicleLODSwitches);
+
+	FVector Velocity = GetVelocity();
+	bSimplified = bNewSimplified;
+
+	if (bSimplified)
+	{
+		// Take the vehicle out of the PhysX vehicle update before the body stops simulating
+		VehicleMovement->DestroyPhysicsState();
+		Primitive->SetSimulatePhysics(false);
+	}
+	else
+	{
+		Primitive->SetSimulatePhysics(true);
+		VehicleMovement->RecreatePhysicsState();
+	}
+
+	SetVelocity(Velocity);
+}
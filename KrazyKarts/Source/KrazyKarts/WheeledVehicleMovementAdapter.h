@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "ReplicatedVehicleMovement.h"
+#include "WheeledVehicleMovementAdapter.generated.h"
+
+class UGoKartMovementComponent;
+class UWheeledVehicleMovementComponent;
+
+// Lets UGoKartMovementReplicator drive a PhysX wheeled vehicle. Moves are applied as vehicle inputs and
+// the physics scene does the stepping, so replays are approximated by dead reckoning.
+// Vehicles far from every player switch to the kinematic kart model, which is cheaper and replays exactly.
+UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
+class KRAZYKARTS_API UWheeledVehicleMovementAdapter : public UActorComponent, public IReplicatedVehicleMovement
+{
+	GENERATED_BODY()
+
+public:	
+	// Sets default values for this component's properties
+	UWheeledVehicleMovementAdapter();
+
+protected:
+	// Called when the game starts
+	virtual void BeginPlay() override;
+
+public:	
+	// Called every frame
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	virtual void SimulateMove(const FGoKartMove& Move) override;
+	virtual void ReplayMoves(const TArray<FGoKartMove>& Moves) override;
+
+	virtual FVector GetVelocity() override;
+	virtual void SetVelocity(FVector NewVelocity) override;
+
+	virtual FGoKartMove GetLastMove() override { return LastMove; }
+
+	void SetThrottle(float NewThrottle) { Throttle = NewThrottle; }
+	void SetSteeringThrow(float NewSteeringThrow) { SteeringThrow = NewSteeringThrow; }
+
+	// Kinematic model used while the vehicle is simplified, its own tick should be disabled
+	void SetSimplifiedMovement(UGoKartMovementComponent* Movement) { SimplifiedMovement = Movement; }
+
+	bool IsSimplified() const { return bSimplified; }
+
+private:
+	UPrimitiveComponent* GetUpdatedPrimitive() const;
+
+	void UpdateSimulationLOD();
+	float GetDistanceToNearestViewer() const;
+	void SetSimplified(bool bNewSimplified);
+
+	// Beyond this distance from every player the vehicle uses the kinematic model (cm)
+	UPROPERTY(EditAnywhere)
+	float SimplifiedDistance = 5000;
+
+	// Distance band around SimplifiedDistance that doesn't cause a switch, stops vehicles flickering between models (cm)
+	UPROPERTY(EditAnywhere)
+	float SimplifiedDistanceHysteresis = 1000;
+
+	// Time between checks of the distance to players (s)
+	UPROPERTY(EditAnywhere)
+	float LODCheckInterval = 0.25;
+
+	float TimeSinceLODCheck;
+
+	bool bSimplified;
+
+	UPROPERTY()
+	UWheeledVehicleMovementComponent* VehicleMovement;
+
+	UPROPERTY()
+	UGoKartMovementComponent* SimplifiedMovement;
+
+	float Throttle;
+
+	float SteeringThrow;
+
+	FGoKartMove LastMove;
+};